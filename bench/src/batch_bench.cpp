@@ -0,0 +1,110 @@
+#include "benchmark/benchmark.h"
+#include "RPPP.hpp"
+#include <vector>
+
+using namespace rppp;
+
+namespace {
+
+// same shape as SampleNetVar in example.cpp
+struct NetVar{
+    int pos[3];
+    int rot[3];
+    int sca[3];
+    float health;
+    uint16_t id;
+};
+
+constexpr size_t items_per_tick = 4096;
+
+template<int parity_size>
+std::vector<StreamData<NetVar, parity_size>> encoded_tick(const std::vector<NetVar>& items){
+    EncodeBuffer<NetVar, parity_size> encoder;
+    std::vector<StreamData<NetVar, parity_size>> packets;
+    StreamData<NetVar, parity_size> sd;
+    for (auto& item : items){
+        encoder.enq(item);
+        while (encoder.deq(&sd) == Status::OK)
+            packets.push_back(sd);
+    }
+    return packets;
+}
+
+template<int parity_size>
+void BM_encode_per_item(benchmark::State& state){
+    std::vector<NetVar> items(items_per_tick, NetVar{});
+    std::vector<StreamData<NetVar, parity_size>> packets(items_per_tick*2);
+    EncodeBuffer<NetVar, parity_size> encoder;
+    for (auto _ : state){
+        size_t sent = 0;
+        for (auto& item : items){
+            encoder.enq(item);
+            while (encoder.deq(&packets[sent]) == Status::OK)
+                sent++;
+        }
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+template<int parity_size>
+void BM_encode_batch(benchmark::State& state){
+    std::vector<NetVar> items(items_per_tick, NetVar{});
+    std::vector<StreamData<NetVar, parity_size>> packets(items_per_tick*2);
+    EncodeBuffer<NetVar, parity_size> encoder;
+    for (auto _ : state){
+        size_t enqueued = 0, sent = 0;
+        while (enqueued < items.size()){
+            enqueued += encoder.enq_batch(span<const NetVar>(items).subspan(enqueued));
+            sent += encoder.drain(span<StreamData<NetVar, parity_size>>(packets).subspan(sent));
+        }
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+template<int parity_size>
+void BM_decode_per_item(benchmark::State& state){
+    std::vector<NetVar> items(items_per_tick, NetVar{});
+    auto packets = encoded_tick<parity_size>(items);
+    DecodeBuffer<NetVar, parity_size> decoder;
+    for (auto _ : state){
+        size_t received = 0;
+        for (auto& sd : packets){
+            decoder.enq(sd);
+            while (decoder.deq(&items[received]) == Status::OK)
+                received++;
+        }
+        decoder.reset();
+        benchmark::DoNotOptimize(items.data());
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+template<int parity_size>
+void BM_decode_batch(benchmark::State& state){
+    std::vector<NetVar> items(items_per_tick, NetVar{});
+    auto packets = encoded_tick<parity_size>(items);
+    DecodeBuffer<NetVar, parity_size> decoder;
+    for (auto _ : state){
+        size_t enqueued = 0, received = 0;
+        while (enqueued < packets.size()){
+            enqueued += decoder.enq_batch(span<const StreamData<NetVar, parity_size>>(packets).subspan(enqueued));
+            received += decoder.drain(span<NetVar>(items).subspan(received));
+        }
+        decoder.reset();
+        benchmark::DoNotOptimize(items.data());
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_encode_per_item, 10);
+BENCHMARK_TEMPLATE(BM_encode_batch, 10);
+BENCHMARK_TEMPLATE(BM_encode_per_item, 30);
+BENCHMARK_TEMPLATE(BM_encode_batch, 30);
+BENCHMARK_TEMPLATE(BM_decode_per_item, 10);
+BENCHMARK_TEMPLATE(BM_decode_batch, 10);
+BENCHMARK_TEMPLATE(BM_decode_per_item, 30);
+BENCHMARK_TEMPLATE(BM_decode_batch, 30);
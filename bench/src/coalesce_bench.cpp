@@ -0,0 +1,114 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_coalesce.hpp"
+#include <vector>
+#include <memory>
+#include <string>
+
+using namespace rppp;
+
+/*
+coalescing of small items (12 B, parity size 10)
+
+    BM_plain_small                  : EncodeBuffer, an item per packet
+    BM_coalesce_encode<K>           : CoalesceEncoder, K items per packet
+    BM_coalesce_decode<K>           : CoalesceDecoder of groups with a lost packet
+
+the counter packets/item is the packets sent per item, parity included.
+*/
+namespace {
+
+struct NetVar0{
+    uint32_t id;
+    float x;
+    float y;
+};
+constexpr int parity_size = 10;
+
+void BM_plain_small(benchmark::State& state){
+    auto encoder = std::make_unique<EncodeBuffer<NetVar0, parity_size>>();
+    StreamData<NetVar0, parity_size> sd;
+    size_t packets = 0;
+    NetVar0 v {};
+    for (auto _ : state){
+        v.id++;
+        encoder->enq(v);
+        while (encoder->deq(&sd) == Status::OK){
+            benchmark::DoNotOptimize(sd);
+            packets++;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["packets/item"] = benchmark::Counter(static_cast<double>(packets)/state.iterations());
+}
+
+template<int K>
+void BM_coalesce_encode(benchmark::State& state){
+    auto encoder = std::make_unique<CoalesceEncoder<NetVar0, K, parity_size>>();
+    StreamData<Batch<NetVar0, K>, parity_size> sd;
+    size_t packets = 0;
+    NetVar0 v {};
+    for (auto _ : state){
+        v.id++;
+        encoder->enq(v);
+        while (encoder->deq(&sd) == Status::OK){
+            benchmark::DoNotOptimize(sd);
+            packets++;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["packets/item"] = benchmark::Counter(static_cast<double>(packets)/state.iterations());
+}
+
+template<int K>
+void BM_coalesce_decode(benchmark::State& state){
+    using Packet = StreamData<Batch<NetVar0, K>, parity_size>;
+    // a group without its first data packet
+    std::vector<Packet> group;
+    {
+        auto encoder = std::make_unique<CoalesceEncoder<NetVar0, K, parity_size>>();
+        Packet sd;
+        NetVar0 v {};
+        for (int i=0; i<K*parity_size; i++){
+            v.id = i;
+            encoder->enq(v);
+        }
+        for (int pos=0; encoder->deq(&sd) == Status::OK; pos++){
+            if (pos > 0)
+                group.push_back(sd);
+        }
+    }
+
+    auto decoder = std::make_unique<CoalesceDecoder<NetVar0, K, parity_size>>();
+    constexpr int group_num = seq_id_wrap(parity_size)/(parity_size+2);
+    NetVar0 out;
+    int number = 0;
+    for (auto _ : state){
+        for (auto& sd : group){
+            sd.header.seq_id = number*(parity_size+2) + (sd.header.seq_id%(parity_size+2));
+            decoder->enq(sd);
+        }
+        while (decoder->deq(&out) == Status::OK)
+            benchmark::DoNotOptimize(out);
+        number = (number+1)%group_num;
+    }
+    state.SetItemsProcessed(state.iterations() * K * parity_size);
+}
+
+template<int K>
+void register_coalesce(){
+    const std::string name = "<" + std::to_string(K) + ">";
+    benchmark::RegisterBenchmark(("BM_coalesce_encode" + name).c_str(), BM_coalesce_encode<K>);
+    benchmark::RegisterBenchmark(("BM_coalesce_decode" + name).c_str(), BM_coalesce_decode<K>);
+}
+
+BENCHMARK(BM_plain_small);
+
+const int registered = []{
+    register_coalesce<1>();
+    register_coalesce<4>();
+    register_coalesce<16>();
+    register_coalesce<64>();
+    return 0;
+}();
+
+}
@@ -0,0 +1,159 @@
+#include "benchmark/benchmark.h"
+#include "RPPP.hpp"
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+using namespace rppp;
+
+/*
+encode / decode hot paths
+
+    BM_encode<bytes, parity_size>           : enq + deq of a group
+    BM_decode<bytes, parity_size>/losses:k  : enq + deq of a group with k lost data packets
+
+parity sizes 8 and 32 are not prime - 1 (compare with 10 and 30).
+items/s and bytes/s are of the payload, and the *_p50_ns / *_p99_ns / *_p999_ns /
+*_max_ns counters are the latency of a single enq() / deq() call.
+*/
+namespace {
+
+template<size_t bytes>
+struct Payload{
+    uint8_t data[bytes];
+};
+
+// latency of every sample_every-th call (timing every call would dominate small payloads)
+class CallLatency{
+    static constexpr size_t sample_every = 16;
+    std::vector<int64_t> m_ns;
+    size_t m_calls = 0;
+
+public:
+    CallLatency(){
+        m_ns.reserve(1 << 16);
+    }
+
+    template<class F>
+    inline Status operator()(F&& f){
+        if (m_calls++ % sample_every)
+            return f();
+        auto start = std::chrono::steady_clock::now();
+        Status status = f();
+        auto end = std::chrono::steady_clock::now();
+        m_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return status;
+    }
+
+    void report(benchmark::State& state, const std::string& name){
+        if (m_ns.empty())
+            return;
+        std::sort(m_ns.begin(), m_ns.end());
+        auto at = [&](double q){
+            return static_cast<double>(m_ns[std::min(m_ns.size()-1, static_cast<size_t>(q*m_ns.size()))]);
+        };
+        state.counters[name + "_p50_ns"] = at(0.5);
+        state.counters[name + "_p99_ns"] = at(0.99);
+        state.counters[name + "_p999_ns"] = at(0.999);
+        state.counters[name + "_max_ns"] = static_cast<double>(m_ns.back());
+    }
+};
+
+template<size_t bytes, int parity_size>
+void BM_encode(benchmark::State& state){
+    using T = Payload<bytes>;
+    auto encoder = std::make_unique<EncodeBuffer<T, parity_size>>();
+    std::vector<T> items(parity_size);
+    for (size_t i=0; i<items.size(); i++)
+        memset(items[i].data, static_cast<int>(i), bytes);
+    StreamData<T, parity_size> sd;
+    CallLatency enq_latency, deq_latency;
+
+    for (auto _ : state){
+        for (auto& item : items){
+            enq_latency([&]{ return encoder->enq(item); });
+            while (deq_latency([&]{ return encoder->deq(&sd); }) == Status::OK)
+                benchmark::DoNotOptimize(sd);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * parity_size);
+    state.SetBytesProcessed(state.iterations() * parity_size * bytes);
+    enq_latency.report(state, "enq");
+    deq_latency.report(state, "deq");
+}
+
+template<size_t bytes, int parity_size>
+void BM_decode(benchmark::State& state){
+    using T = Payload<bytes>;
+    const int losses = state.range(0);
+
+    // a group without the lost data packets (columns 0 and parity_size-1)
+    std::vector<StreamData<T, parity_size>> group;
+    {
+        auto encoder = std::make_unique<EncodeBuffer<T, parity_size>>();
+        T item;
+        StreamData<T, parity_size> sd;
+        for (int i=0; i<parity_size; i++){
+            memset(item.data, i, bytes);
+            encoder->enq(item);
+        }
+        for (int pos=0; encoder->deq(&sd) == Status::OK; pos++){
+            if ((losses >= 1 && pos == 0) || (losses >= 2 && pos == parity_size-1))
+                continue;
+            group.push_back(sd);
+        }
+    }
+
+    auto decoder = std::make_unique<DecodeBuffer<T, parity_size>>();
+    auto out = std::make_unique<T>();
+    constexpr int group_num = seq_id_wrap(parity_size)/(parity_size+2);
+    int number = 0;
+    CallLatency enq_latency, deq_latency;
+
+    for (auto _ : state){
+        // the same group again with the next seq_id
+        for (auto& sd : group){
+            sd.header.seq_id = number*(parity_size+2) + (sd.header.seq_id%(parity_size+2));
+            enq_latency([&]{ return decoder->enq(sd); });
+        }
+        while (deq_latency([&]{ return decoder->deq(out.get()); }) == Status::OK)
+            benchmark::DoNotOptimize(*out);
+        number = (number+1)%group_num;
+    }
+    state.SetItemsProcessed(state.iterations() * parity_size);
+    state.SetBytesProcessed(state.iterations() * parity_size * bytes);
+    enq_latency.report(state, "enq");
+    deq_latency.report(state, "deq");
+}
+
+template<size_t bytes, int parity_size>
+void register_codec(){
+    const std::string name = "<" + std::to_string(bytes) + ", " + std::to_string(parity_size) + ">";
+    benchmark::RegisterBenchmark(("BM_encode" + name).c_str(), BM_encode<bytes, parity_size>);
+    benchmark::RegisterBenchmark(("BM_decode" + name).c_str(), BM_decode<bytes, parity_size>)
+        ->ArgName("losses")->DenseRange(0, 2);
+}
+
+template<int parity_size>
+void register_payloads(){
+    register_codec<8, parity_size>();
+    register_codec<64, parity_size>();
+    register_codec<256, parity_size>();
+    register_codec<1400, parity_size>();
+}
+
+const int registered = []{
+    register_payloads<2>();
+    register_payloads<4>();
+    register_payloads<6>();
+    register_payloads<8>();     // padded to 10 (virtual zero columns)
+    register_payloads<10>();
+    register_payloads<30>();
+    register_payloads<32>();    // padded to 36
+    register_payloads<100>();
+    return 0;
+}();
+
+}
@@ -0,0 +1,130 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_delta.hpp"
+#include <vector>
+#include <memory>
+
+using namespace rppp;
+
+/*
+delta compression in front of the encoder
+
+    BM_plain_encode/changed:c    : EncodeBuffer of the snapshots, full packets on the wire
+    BM_delta_encode/changed:c    : DeltaEncoder + EncodeBuffer, wire_size() packets
+    BM_delta_decode/changed:c    : from_wire + DecodeBuffer + DeltaDecoder of a group with a lost packet
+
+c is the number of changed fields (of 64) per snapshot. the counter
+wire_bytes/item is the bytes sent per item, parity included.
+*/
+namespace {
+
+struct Snapshot{
+    uint32_t fields[64];
+};
+constexpr int parity_size = 10;
+
+Snapshot tick(int i, int changed){
+    Snapshot s {};
+    for (int f=0; f<64; f++)
+        s.fields[f] = 1000 + f;
+    for (int f=0; f<changed; f++)
+        s.fields[(f*7)%64] += i;
+    return s;
+}
+
+void BM_plain_encode(benchmark::State& state){
+    const int changed = state.range(0);
+    auto e_buf = std::make_unique<EncodeBuffer<Snapshot, parity_size>>();
+    StreamData<Snapshot, parity_size> sd;
+    size_t wire_bytes = 0;
+    int i = 0;
+    for (auto _ : state){
+        e_buf->enq(tick(i++, changed));
+        while (e_buf->deq(&sd) == Status::OK){
+            benchmark::DoNotOptimize(sd);
+            wire_bytes += sizeof(sd);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["wire_bytes/item"] = benchmark::Counter(static_cast<double>(wire_bytes)/state.iterations());
+}
+
+void BM_delta_encode(benchmark::State& state){
+    const int changed = state.range(0);
+    auto d_enc = std::make_unique<DeltaEncoder<Snapshot>>();
+    auto e_buf = std::make_unique<EncodeBuffer<Delta<Snapshot>, parity_size>>();
+    Delta<Snapshot> delta;
+    StreamData<Delta<Snapshot>, parity_size> sd;
+    size_t wire_bytes = 0;
+    int i = 0;
+    for (auto _ : state){
+        d_enc->encode(tick(i++, changed), &delta);
+        e_buf->enq(delta);
+        while (e_buf->deq(&sd) == Status::OK){
+            benchmark::DoNotOptimize(sd);
+            wire_bytes += wire_size(sd);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["wire_bytes/item"] = benchmark::Counter(static_cast<double>(wire_bytes)/state.iterations());
+}
+
+void BM_delta_decode(benchmark::State& state){
+    const int changed = state.range(0);
+    using Packet = StreamData<Delta<Snapshot>, parity_size>;
+
+    // the wire packets of a long run of groups, without the first data packet of each group
+    constexpr int groups = 64;
+    std::vector<std::vector<uint8_t>> wire;
+    {
+        auto d_enc = std::make_unique<DeltaEncoder<Snapshot>>();
+        d_enc->set_keyframe_interval(0);
+        auto e_buf = std::make_unique<EncodeBuffer<Delta<Snapshot>, parity_size>>();
+        Delta<Snapshot> delta;
+        Packet sd;
+        int packets = 0;
+        for (int i=0; i<groups*parity_size; i++){
+            d_enc->encode(tick(i, changed), &delta);
+            e_buf->enq(delta);
+            while (e_buf->deq(&sd) == Status::OK){
+                if (packets++ % (parity_size+2) == 0)
+                    continue;
+                const auto *p = reinterpret_cast<const uint8_t*>(&sd);
+                wire.emplace_back(p, p + wire_size(sd));
+            }
+        }
+    }
+
+    auto d_buf = std::make_unique<DecodeBuffer<Delta<Snapshot>, parity_size>>();
+    auto d_dec = std::make_unique<DeltaDecoder<Snapshot>>();
+    auto received = std::make_unique<Packet>();
+    Delta<Snapshot> delta;
+    Snapshot out;
+    size_t decoded = 0;
+    for (auto _ : state){
+        // the same seq ids every round: start over
+        d_buf->reset();
+        d_dec->reset();
+        for (auto& w : wire){
+            from_wire(w.data(), w.size(), received.get());
+            d_buf->enq(*received);
+            while (d_buf->deq(&delta) == Status::OK){
+                decoded += d_dec->decode(delta, &out) == Status::OK;
+                benchmark::DoNotOptimize(out);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * groups * parity_size);
+    state.counters["decoded/round"] = benchmark::Counter(static_cast<double>(decoded)/state.iterations());
+}
+
+void changed_fields(benchmark::internal::Benchmark* b){
+    b->ArgName("changed");
+    for (int c : {1, 4, 16, 64})
+        b->Arg(c);
+}
+
+BENCHMARK(BM_plain_encode)->Apply(changed_fields);
+BENCHMARK(BM_delta_encode)->Apply(changed_fields);
+BENCHMARK(BM_delta_decode)->Apply(changed_fields);
+
+}
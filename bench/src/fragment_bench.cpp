@@ -0,0 +1,87 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_fragment.hpp"
+#include <vector>
+#include <memory>
+
+using namespace rppp;
+
+/*
+fragmentation of large messages (shards of 1400 B)
+
+    BM_fragment_encode/size          : enq + deq of a message
+    BM_fragment_decode/size/losses:e : enq + deq of a message with e lost data shards
+*/
+namespace {
+
+constexpr size_t max_message = 64*1024;
+using Encoder = FragmentEncoder<max_message>;
+using Decoder = FragmentDecoder<max_message>;
+
+void BM_fragment_encode(benchmark::State& state){
+    const size_t size = state.range(0);
+    auto encoder = std::make_unique<Encoder>();
+    std::vector<uint8_t> message(size, 7);
+    for (auto _ : state){
+        encoder->enq(message.data(), size);
+        while (const Encoder::Packet *f = encoder->peek()){
+            benchmark::DoNotOptimize(f->wire_size());
+            encoder->pop();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_fragment_decode(benchmark::State& state){
+    const size_t size = state.range(0);
+    const int losses = state.range(1);
+
+    // the packets of a message without the first `losses` data shards
+    std::vector<std::vector<uint8_t>> wire;
+    {
+        auto encoder = std::make_unique<Encoder>();
+        std::vector<uint8_t> message(size);
+        for (size_t i=0; i<size; i++)
+            message[i] = static_cast<uint8_t>(i);
+        encoder->enq(message.data(), size);
+        for (int pos=0; const Encoder::Packet *f = encoder->peek(); pos++){
+            const auto *p = reinterpret_cast<const uint8_t*>(f);
+            if (pos >= losses)
+                wire.emplace_back(p, p + f->wire_size());
+            encoder->pop();
+        }
+    }
+
+    auto decoder = std::make_unique<Decoder>();
+    span<const uint8_t> out;
+    uint32_t number = 0;
+    for (auto _ : state){
+        for (auto& w : wire){
+            memcpy(w.data(), &number, sizeof(number)); // FragmentHeader::message
+            decoder->enq(w.data(), w.size());
+        }
+        while (decoder->deq(&out) == Status::OK)
+            benchmark::DoNotOptimize(out.data());
+        number++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void message_sizes(benchmark::internal::Benchmark* b){
+    for (int size : {4000, 16000, 64000})
+        b->Arg(size);
+}
+
+void message_losses(benchmark::internal::Benchmark* b){
+    b->ArgNames({"size", "losses"});
+    for (int size : {4000, 16000, 64000}){
+        for (int losses=0; losses<=2; losses++)
+            b->Args({size, losses});
+    }
+}
+
+BENCHMARK(BM_fragment_encode)->Apply(message_sizes);
+BENCHMARK(BM_fragment_decode)->Apply(message_losses);
+
+}
@@ -0,0 +1,119 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_parallel.hpp"
+#include <vector>
+#include <memory>
+#include <thread>
+
+using namespace rppp;
+
+/*
+scaling of WorkStealingPool from 1 to N threads (the caller + threads-1 workers)
+
+    BM_parallel_sessions/threads:T : a group with 2 lost data packets for each of
+                                     4096 sessions, routed by ParallelRouter and drained
+    BM_parallel_columns/threads:T  : a group of 256KB items with 2 lost data packets,
+                                     recovered in column range tasks
+*/
+namespace {
+
+struct Input{
+    uint8_t data[256];
+};
+struct Frame{
+    uint8_t data[256*1024];
+};
+
+void BM_parallel_sessions(benchmark::State& state){
+    constexpr int parity_size = 10;
+    constexpr size_t flows = 4096;
+    using Manager = SessionManager<Input, parity_size>;
+    WorkStealingPool pool(static_cast<unsigned>(state.range(0)) - 1);
+    auto sessions = std::make_unique<Manager>();
+    ParallelRouter<Manager> router;
+
+    // a group without the data packets 0 and 1, in the same order for every flow
+    std::vector<Manager::Data> packets;
+    std::vector<Manager::Datagram> datagrams;
+    {
+        EncodeBuffer<Input, parity_size> encoder;
+        Input item {};
+        for (int i=0; i<parity_size; i++)
+            encoder.enq(item);
+        Manager::Data sd;
+        for (int pos=0; encoder.deq(&sd) == Status::OK; pos++){
+            if (pos < 2)
+                continue;
+            for (size_t f=0; f<flows; f++)
+                packets.push_back(sd);
+        }
+        for (size_t i=0; i<packets.size(); i++)
+            datagrams.push_back({i%flows, &packets[i]});
+    }
+
+    constexpr int group_num = seq_id_wrap(parity_size)/(parity_size+2);
+    int number = 0;
+    for (auto _ : state){
+        router.enq_batch(pool, *sessions, datagrams);
+        parallel_for_each(pool, *sessions, 64, [](Manager::Session& s){
+            Input out;
+            while (s.decoder.deq(&out) == Status::OK)
+                benchmark::DoNotOptimize(out);
+        });
+        number = (number+1)%group_num;
+        for (auto& sd : packets)
+            sd.header.seq_id = number*(parity_size+2) + sd.header.seq_id%(parity_size+2);
+    }
+    state.SetItemsProcessed(state.iterations() * flows * parity_size);
+}
+
+void BM_parallel_columns(benchmark::State& state){
+    constexpr int parity_size = 4;
+    WorkStealingPool pool(static_cast<unsigned>(state.range(0)) - 1);
+    auto decoder = std::make_unique<DecodeBuffer<Frame, parity_size>>();
+    decoder->set_splitter(pool.splitter());
+
+    std::vector<StreamData<Frame, parity_size>> group;
+    {
+        auto encoder = std::make_unique<EncodeBuffer<Frame, parity_size>>();
+        auto item = std::make_unique<Frame>();
+        auto sd = std::make_unique<StreamData<Frame, parity_size>>();
+        for (int i=0; i<parity_size; i++){
+            memset(item->data, i, sizeof(item->data));
+            encoder->enq(*item);
+        }
+        for (int pos=0; encoder->deq(sd.get()) == Status::OK; pos++){
+            if (pos >= 2)
+                group.push_back(*sd);
+        }
+    }
+
+    auto out = std::make_unique<Frame>();
+    constexpr int group_num = seq_id_wrap(parity_size)/(parity_size+2);
+    int number = 0;
+    for (auto _ : state){
+        for (auto& sd : group){
+            sd.header.seq_id = number*(parity_size+2) + sd.header.seq_id%(parity_size+2);
+            decoder->enq(sd);
+        }
+        while (decoder->deq(out.get()) == Status::OK)
+            benchmark::DoNotOptimize(*out);
+        number = (number+1)%group_num;
+    }
+    state.SetBytesProcessed(state.iterations() * parity_size * sizeof(Frame));
+}
+
+const int registered = []{
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    auto threads = [&](benchmark::internal::Benchmark* b){
+        b->ArgName("threads");
+        for (int t=1; t<cores; t*=2)
+            b->Arg(t);
+        b->Arg(cores);
+        b->UseRealTime();
+    };
+    threads(benchmark::RegisterBenchmark("BM_parallel_sessions", BM_parallel_sessions));
+    threads(benchmark::RegisterBenchmark("BM_parallel_columns", BM_parallel_columns));
+    return 0;
+}();
+
+}
@@ -0,0 +1,77 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_pipeline.hpp"
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace rppp;
+
+/*
+encoder hand-off between two threads
+
+    BM_handoff_spsc  : PipelineEncoder (the producer thread enq, this thread deq)
+    BM_handoff_mutex : an EncodeBuffer guarded by a std::mutex
+
+each iteration moves `batch` items. items/s is the throughput of the pair.
+*/
+namespace {
+
+struct Input{
+    uint8_t data[64];
+};
+constexpr int parity_size = 10;
+constexpr int batch = 4000;
+static_assert(batch%parity_size == 0, "batch must be whole groups.");
+
+template<class Enq, class Deq>
+void handoff(benchmark::State& state, Enq&& enq, Deq&& deq){
+    StreamData<Input, parity_size> sd;
+    for (auto _ : state){
+        std::thread producer([&]{
+            Input item {};
+            for (int i=0; i<batch;){
+                item.data[0] = static_cast<uint8_t>(i);
+                if (enq(item) != Status::BUFFER_FULL)
+                    i++;
+                else
+                    std::this_thread::yield();
+            }
+        });
+        for (int packets = 0; packets < batch/parity_size*(parity_size+2);){ // data + P + Q
+            if (deq(&sd) == Status::OK){
+                benchmark::DoNotOptimize(sd);
+                packets++;
+            }
+            else
+                std::this_thread::yield();
+        }
+        producer.join();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+void BM_handoff_spsc(benchmark::State& state){
+    auto encoder = std::make_unique<PipelineEncoder<Input, parity_size>>();
+    handoff(state,
+        [&](const Input& item){ return encoder->enq(item); },
+        [&](StreamData<Input, parity_size>* sd){ return encoder->deq(sd); });
+}
+
+void BM_handoff_mutex(benchmark::State& state){
+    auto encoder = std::make_unique<EncodeBuffer<Input, parity_size>>();
+    std::mutex mutex;
+    handoff(state,
+        [&](const Input& item){
+            std::lock_guard<std::mutex> lock(mutex);
+            return encoder->enq(item);
+        },
+        [&](StreamData<Input, parity_size>* sd){
+            std::lock_guard<std::mutex> lock(mutex);
+            return encoder->deq(sd);
+        });
+}
+
+BENCHMARK(BM_handoff_spsc)->UseRealTime();
+BENCHMARK(BM_handoff_mutex)->UseRealTime();
+
+}
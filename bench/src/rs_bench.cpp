@@ -0,0 +1,128 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_rs.hpp"
+#include <vector>
+#include <memory>
+#include <string>
+
+using namespace rppp;
+
+/*
+Reed-Solomon codec
+
+    BM_gf_mul_acc/<isa>/len              : dst ^= c * src of a block
+    BM_rs_encode<bytes, k, m>            : enq + deq of a group
+    BM_rs_decode<bytes, k, m>/losses:e   : enq + deq of a group with e lost data packets
+
+compare with BM_encode / BM_decode of codec_bench (XOR parity, 2 losses).
+*/
+namespace {
+
+template<size_t bytes>
+struct Payload{
+    uint8_t data[bytes];
+};
+
+void BM_gf_mul_acc(benchmark::State& state, gf256::GfIsa isa){
+    if (not gf256::gf_isa_supported(isa)){
+        state.SkipWithError("not supported on this cpu");
+        return;
+    }
+    gf256::GfKernel kernel = gf256::gf_kernel_for(isa);
+    size_t len = state.range(0);
+    std::vector<uint8_t> dst(len, 1), src(len, 2);
+    for (auto _ : state){
+        kernel.mul_acc(dst.data(), src.data(), 0x53, len);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+
+template<size_t bytes, int k, int m>
+void BM_rs_encode(benchmark::State& state){
+    using T = Payload<bytes>;
+    auto encoder = std::make_unique<RsEncodeBuffer<T, k, m>>();
+    std::vector<T> items(k);
+    for (size_t i=0; i<items.size(); i++)
+        memset(items[i].data, static_cast<int>(i), bytes);
+    StreamData<T, 1> sd;
+
+    for (auto _ : state){
+        for (auto& item : items){
+            encoder->enq(item);
+            while (encoder->deq(&sd) == Status::OK)
+                benchmark::DoNotOptimize(sd);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+    state.SetBytesProcessed(state.iterations() * k * bytes);
+}
+
+template<size_t bytes, int k, int m>
+void BM_rs_decode(benchmark::State& state){
+    using T = Payload<bytes>;
+    const int losses = state.range(0);
+
+    // a group without the first `losses` data packets
+    std::vector<StreamData<T, 1>> group;
+    {
+        auto encoder = std::make_unique<RsEncodeBuffer<T, k, m>>();
+        T item;
+        StreamData<T, 1> sd;
+        for (int i=0; i<k; i++){
+            memset(item.data, i, bytes);
+            encoder->enq(item);
+        }
+        for (int pos=0; encoder->deq(&sd) == Status::OK; pos++){
+            if (pos < losses)
+                continue;
+            group.push_back(sd);
+        }
+    }
+
+    auto decoder = std::make_unique<RsDecodeBuffer<T, k, m>>();
+    auto out = std::make_unique<T>();
+    constexpr int header_n = k+m-2;
+    constexpr int group_num = seq_id_wrap(header_n)/(k+m);
+    int number = 0;
+
+    for (auto _ : state){
+        for (auto& sd : group){
+            sd.header.seq_id = number*(k+m) + (sd.header.seq_id%(k+m));
+            decoder->enq(sd);
+        }
+        while (decoder->deq(out.get()) == Status::OK)
+            benchmark::DoNotOptimize(*out);
+        number = (number+1)%group_num;
+    }
+    state.SetItemsProcessed(state.iterations() * k);
+    state.SetBytesProcessed(state.iterations() * k * bytes);
+}
+
+template<size_t bytes, int k, int m>
+void register_rs(){
+    const std::string name = "<" + std::to_string(bytes) + ", " + std::to_string(k) + ", " + std::to_string(m) + ">";
+    benchmark::RegisterBenchmark(("BM_rs_encode" + name).c_str(), BM_rs_encode<bytes, k, m>);
+    benchmark::RegisterBenchmark(("BM_rs_decode" + name).c_str(), BM_rs_decode<bytes, k, m>)
+        ->ArgName("losses")->DenseRange(0, m);
+}
+
+void block_sizes(benchmark::internal::Benchmark* b){
+    for (int len : {64, 256, 1400, 4096})
+        b->Arg(len);
+}
+
+BENCHMARK_CAPTURE(BM_gf_mul_acc, portable, gf256::GfIsa::PORTABLE)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_gf_mul_acc, ssse3, gf256::GfIsa::SSSE3)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_gf_mul_acc, avx2, gf256::GfIsa::AVX2)->Apply(block_sizes);
+
+const int registered = []{
+    register_rs<64, 10, 2>();
+    register_rs<64, 10, 4>();
+    register_rs<1400, 10, 2>();
+    register_rs<1400, 10, 4>();
+    register_rs<1400, 20, 4>();
+    return 0;
+}();
+
+}
@@ -0,0 +1,74 @@
+#include "benchmark/benchmark.h"
+#include "RPPP_session.hpp"
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+
+using namespace rppp;
+
+/*
+SessionManager routing
+
+    BM_sessions/sessions:N : a group of every flow, interleaved over N flows and
+                             routed in batches of 64 datagrams, then drained
+
+items/s should stay flat as N grows (session_bytes is the memory of a session).
+*/
+namespace {
+
+struct Input{
+    uint8_t data[64];
+};
+constexpr int parity_size = 4;
+using Manager = SessionManager<Input, parity_size>;
+
+void BM_sessions(benchmark::State& state){
+    const size_t flows = state.range(0);
+    auto sessions = std::make_unique<Manager>();
+
+    // a group of each flow, sent packet by packet of all flows in a random flow order
+    std::vector<Manager::Data> packets(flows*(parity_size+2));
+    std::vector<Manager::Datagram> datagrams(packets.size());
+    {
+        EncodeBuffer<Input, parity_size> encoder;
+        Input item {};
+        for (int i=0; i<parity_size; i++)
+            encoder.enq(item);
+        std::vector<uint64_t> order(flows);
+        for (size_t f=0; f<flows; f++)
+            order[f] = f*2654435761u;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        Manager::Data sd;
+        for (int pos=0; encoder.deq(&sd) == Status::OK; pos++){
+            for (size_t f=0; f<flows; f++){
+                packets[pos*flows + f] = sd;
+                datagrams[pos*flows + f] = {order[f], &packets[pos*flows + f]};
+            }
+        }
+    }
+
+    constexpr int group_num = seq_id_wrap(parity_size)/(parity_size+2);
+    int number = 0;
+    Input out;
+    for (auto _ : state){
+        for (size_t i=0; i<datagrams.size(); i+=64)
+            sessions->enq_batch({datagrams.data()+i, std::min<size_t>(64, datagrams.size()-i)});
+        sessions->for_each([&](Manager::Session& s){
+            while (s.decoder.deq(&out) == Status::OK)
+                benchmark::DoNotOptimize(out);
+        });
+
+        // the next group
+        number = (number+1)%group_num;
+        for (auto& sd : packets)
+            sd.header.seq_id = number*(parity_size+2) + sd.header.seq_id%(parity_size+2);
+    }
+    state.SetItemsProcessed(state.iterations() * flows * parity_size);
+    state.counters["session_bytes"] = Manager::session_bytes();
+    state.counters["memory_per_session"] = sessions->memory_per_session();
+}
+
+BENCHMARK(BM_sessions)->ArgName("sessions")->RangeMultiplier(8)->Range(1, 1 << 15);
+
+}
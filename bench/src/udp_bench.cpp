@@ -0,0 +1,87 @@
+#if defined(__linux__)
+#include "benchmark/benchmark.h"
+#include "RPPP_udp.hpp"
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <memory>
+
+using namespace rppp;
+
+/*
+UDP loopback packets per second, a parity group per iteration
+
+    BM_udp/mode:0 : send() / recv() per packet (a syscall per StreamData)
+    BM_udp/mode:1 : UdpSender (sendmmsg) / UdpReceiver (recvmmsg)
+    BM_udp/mode:2 : UdpSender (UDP GSO) / UdpReceiver (recvmmsg)
+*/
+namespace {
+
+struct Input{
+    uint8_t data[64];
+};
+constexpr int parity_size = 10;
+using Data = StreamData<Input, parity_size>;
+
+struct Loopback{
+    int rx;
+    int tx;
+
+    Loopback(){
+        rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        tx = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &len);
+        connect(tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    ~Loopback(){
+        close(rx);
+        close(tx);
+    }
+};
+
+void BM_udp(benchmark::State& state){
+    const int mode = state.range(0);
+    Loopback sock;
+    Input item {};
+    size_t items = 0;
+
+    if (mode == 0){
+        auto encoder = std::make_unique<EncodeBuffer<Input, parity_size>>();
+        auto decoder = std::make_unique<DecodeBuffer<Input, parity_size>>();
+        Data sd;
+        for (auto _ : state){
+            for (int i=0; i<parity_size; i++){
+                encoder->enq(item);
+                while (encoder->deq(&sd) == Status::OK)
+                    send(sock.tx, &sd, sizeof(sd), 0);
+            }
+            while (recv(sock.rx, &sd, sizeof(sd), 0) == static_cast<ssize_t>(sizeof(sd)))
+                decoder->enq(sd);
+            while (decoder->deq(&item) == Status::OK)
+                items++;
+        }
+    }
+    else{
+        auto sender = std::make_unique<UdpSender<Input, parity_size>>(sock.tx, nullptr, 0, mode == 2);
+        auto receiver = std::make_unique<UdpReceiver<Input, parity_size>>(sock.rx);
+        for (auto _ : state){
+            for (int i=0; i<parity_size; i++)
+                sender->send(item);
+            receiver->receive([&](const Input&){ items++; });
+        }
+        if (mode == 2 && not sender->gso())
+            state.SetLabel("no GSO (sendmmsg)");
+    }
+    state.SetItemsProcessed(items);
+    state.counters["packets_per_second"] = benchmark::Counter(
+        static_cast<double>(state.iterations()*(parity_size+2)), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_udp)->ArgName("mode")->DenseRange(0, 2);
+
+}
+#endif
@@ -0,0 +1,80 @@
+#include "benchmark/benchmark.h"
+#include "RPPP.hpp"
+#include <vector>
+
+using namespace rppp::simd;
+
+// byte by byte xor. (same as the old block_xor)
+static void xor_bytewise(uint8_t *dst, const uint8_t *src, size_t len){
+    for (size_t i=0; i<len; i++)
+        dst[i] = dst[i] xor src[i];
+}
+
+static void BM_xor_bytewise(benchmark::State& state){
+    size_t len = state.range(0);
+    std::vector<uint8_t> dst(len, 1), src(len, 2);
+    for (auto _ : state){
+        xor_bytewise(dst.data(), src.data(), len);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+
+static void BM_xor_into(benchmark::State& state, XorIsa isa){
+    if (not xor_isa_supported(isa)){
+        state.SkipWithError("not supported on this cpu");
+        return;
+    }
+    XorKernel kernel = xor_kernel_for(isa);
+    size_t len = state.range(0);
+    std::vector<uint8_t> dst(len, 1), src(len, 2);
+    for (auto _ : state){
+        kernel.xor_into(dst.data(), src.data(), len);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+
+// parity of a group: dst = xor of parity_size rows
+static void BM_xor_acc(benchmark::State& state, XorIsa isa){
+    if (not xor_isa_supported(isa)){
+        state.SkipWithError("not supported on this cpu");
+        return;
+    }
+    XorKernel kernel = xor_kernel_for(isa);
+    size_t len = state.range(0);
+    size_t rows = state.range(1);
+    std::vector<std::vector<uint8_t>> src(rows, std::vector<uint8_t>(len, 3));
+    std::vector<const uint8_t*> srcs;
+    for (auto& s : src)
+        srcs.push_back(s.data());
+    std::vector<uint8_t> dst(len, 1);
+    for (auto _ : state){
+        kernel.xor_acc(dst.data(), srcs.data(), rows, len);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * len * rows);
+}
+
+static void block_sizes(benchmark::internal::Benchmark* b){
+    for (int len : {8, 16, 32, 64, 140, 256, 512, 1400, 4096})
+        b->Arg(len);
+}
+static void group_sizes(benchmark::internal::Benchmark* b){
+    for (int len : {64, 1400})
+        for (int rows : {4, 10, 30, 100})
+            b->Args({len, rows});
+}
+
+BENCHMARK(BM_xor_bytewise)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_xor_into, portable, XorIsa::PORTABLE)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_xor_into, sse2, XorIsa::SSE2)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_xor_into, avx2, XorIsa::AVX2)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_xor_into, avx512, XorIsa::AVX512)->Apply(block_sizes);
+BENCHMARK_CAPTURE(BM_xor_acc, portable, XorIsa::PORTABLE)->Apply(group_sizes);
+BENCHMARK_CAPTURE(BM_xor_acc, sse2, XorIsa::SSE2)->Apply(group_sizes);
+BENCHMARK_CAPTURE(BM_xor_acc, avx2, XorIsa::AVX2)->Apply(group_sizes);
+BENCHMARK_CAPTURE(BM_xor_acc, avx512, XorIsa::AVX512)->Apply(group_sizes);
@@ -1,9 +1,33 @@
 #pragma once
 #include <array>
-#include <vector>
-#include <queue>
 #include <limits>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <utility>
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+#ifndef RPPP_XOR_X86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RPPP_XOR_X86 1
+#else
+#define RPPP_XOR_X86 0
+#endif
+#endif
+#if RPPP_XOR_X86
+#include <immintrin.h>
+#endif
+
+// per instance counters and histograms (EncodeBuffer::stats(), DecodeBuffer::stats())
+#ifndef RPPP_STATS
+#define RPPP_STATS 0
+#endif
+#if RPPP_STATS
+#include <atomic>
+#endif
 
 namespace rppp{
 
@@ -34,6 +58,15 @@ namespace rppp{
         }
         return true;
     }
+    // columns of the parity geometry of parity_size data columns: the smallest
+    // n >= parity_size with n+1 prime. the columns parity_size..n-1 are virtual
+    // zero columns, which are neither stored nor sent
+    constexpr int padded_size(int parity_size){
+        int n = parity_size;
+        while (not is_prime(n+1))
+            n++;
+        return n;
+    }
     constexpr int multi_ceil(int n, int m){
         return (n+m-1)/m*m;
     }
@@ -41,385 +74,1637 @@ namespace rppp{
         return n/m*m;
     }
 
+    /*
+    block xor engine
+
+    All parity work in RPPP is xor of byte rows. The kernels below are
+    selected once at startup from the running cpu (SSE2 / AVX2 / AVX-512),
+    and fall back to a 64bit wide-word loop on other targets.
+    */
+    namespace simd{
+        using xor_into_t = void (*)(uint8_t *dst, const uint8_t *src, size_t len);
+        using xor_acc_t = void (*)(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len);
+
+        enum XorIsa{
+            PORTABLE,
+            SSE2,
+            AVX2,
+            AVX512,
+        };
+
+        struct XorKernel{
+            XorIsa isa;
+            const char *name;
+            xor_into_t xor_into;    // dst ^= src
+            xor_acc_t xor_acc;      // dst ^= srcs[0] ^ srcs[1] ^ ... ^ srcs[count-1]
+        };
+
+        inline void xor_into_portable(uint8_t *dst, const uint8_t *src, size_t len){
+            size_t i = 0;
+            for (; i+sizeof(uint64_t) <= len; i += sizeof(uint64_t)){
+                uint64_t a, b;
+                memcpy(&a, dst+i, sizeof(a));
+                memcpy(&b, src+i, sizeof(b));
+                a ^= b;
+                memcpy(dst+i, &a, sizeof(a));
+            }
+            for (; i<len; i++)
+                dst[i] ^= src[i];
+        }
+        inline void xor_acc_portable(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len){
+            size_t i = 0;
+            for (; i+sizeof(uint64_t) <= len; i += sizeof(uint64_t)){
+                uint64_t a, b;
+                memcpy(&a, dst+i, sizeof(a));
+                for (size_t s=0; s<count; s++){
+                    memcpy(&b, srcs[s]+i, sizeof(b));
+                    a ^= b;
+                }
+                memcpy(dst+i, &a, sizeof(a));
+            }
+            for (; i<len; i++){
+                uint8_t a = dst[i];
+                for (size_t s=0; s<count; s++)
+                    a ^= srcs[s][i];
+                dst[i] = a;
+            }
+        }
+
+    #if RPPP_XOR_X86
+        __attribute__((target("sse2")))
+        inline void xor_into_sse2(uint8_t *dst, const uint8_t *src, size_t len){
+            size_t i = 0;
+            for (; i+16 <= len; i += 16){
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst+i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_xor_si128(a, b));
+            }
+            xor_into_portable(dst+i, src+i, len-i);
+        }
+        __attribute__((target("sse2")))
+        inline void xor_acc_sse2(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len){
+            size_t i = 0;
+            for (; i+16 <= len; i += 16){
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst+i));
+                for (size_t s=0; s<count; s++)
+                    a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcs[s]+i)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), a);
+            }
+            for (; i<len; i++){
+                uint8_t a = dst[i];
+                for (size_t s=0; s<count; s++)
+                    a ^= srcs[s][i];
+                dst[i] = a;
+            }
+        }
+
+        __attribute__((target("avx2")))
+        inline void xor_into_avx2(uint8_t *dst, const uint8_t *src, size_t len){
+            size_t i = 0;
+            for (; i+32 <= len; i += 32){
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst+i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src+i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_xor_si256(a, b));
+            }
+            xor_into_sse2(dst+i, src+i, len-i);
+        }
+        __attribute__((target("avx2")))
+        inline void xor_acc_avx2(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len){
+            size_t i = 0;
+            for (; i+32 <= len; i += 32){
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst+i));
+                for (size_t s=0; s<count; s++)
+                    a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcs[s]+i)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), a);
+            }
+            for (size_t s=0; i<len && s<count; s++)
+                xor_into_sse2(dst+i, srcs[s]+i, len-i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void xor_into_avx512(uint8_t *dst, const uint8_t *src, size_t len){
+            size_t i = 0;
+            for (; i+64 <= len; i += 64){
+                __m512i a = _mm512_loadu_si512(dst+i);
+                __m512i b = _mm512_loadu_si512(src+i);
+                _mm512_storeu_si512(dst+i, _mm512_xor_si512(a, b));
+            }
+            xor_into_avx2(dst+i, src+i, len-i);
+        }
+        __attribute__((target("avx512f")))
+        inline void xor_acc_avx512(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len){
+            size_t i = 0;
+            for (; i+64 <= len; i += 64){
+                __m512i a = _mm512_loadu_si512(dst+i);
+                for (size_t s=0; s<count; s++)
+                    a = _mm512_xor_si512(a, _mm512_loadu_si512(srcs[s]+i));
+                _mm512_storeu_si512(dst+i, a);
+            }
+            for (size_t s=0; i<len && s<count; s++)
+                xor_into_sse2(dst+i, srcs[s]+i, len-i);
+        }
+    #endif
+
+        inline bool xor_isa_supported(XorIsa isa){
+            switch (isa){
+            case XorIsa::PORTABLE:
+                return true;
+    #if RPPP_XOR_X86
+            case XorIsa::SSE2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("sse2");
+            case XorIsa::AVX2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+            case XorIsa::AVX512:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx512f");
+    #endif
+            default:
+                return false;
+            }
+        }
+
+        // kernel of the given isa. (the caller has to check xor_isa_supported())
+        inline XorKernel xor_kernel_for(XorIsa isa){
+            switch (isa){
+    #if RPPP_XOR_X86
+            case XorIsa::SSE2:   return {isa, "sse2", xor_into_sse2, xor_acc_sse2};
+            case XorIsa::AVX2:   return {isa, "avx2", xor_into_avx2, xor_acc_avx2};
+            case XorIsa::AVX512: return {isa, "avx512", xor_into_avx512, xor_acc_avx512};
+    #endif
+            default:             return {XorIsa::PORTABLE, "portable", xor_into_portable, xor_acc_portable};
+            }
+        }
+
+        // the best kernel for the running cpu. (detected on the first call)
+        inline const XorKernel& xor_kernel(){
+            static const XorKernel kernel = []{
+                for (XorIsa isa : {XorIsa::AVX512, XorIsa::AVX2, XorIsa::SSE2}){
+                    if (xor_isa_supported(isa))
+                        return xor_kernel_for(isa);
+                }
+                return xor_kernel_for(XorIsa::PORTABLE);
+            }();
+            return kernel;
+        }
+
+        // dst ^= src
+        inline void xor_into(uint8_t *dst, const uint8_t *src, size_t len){
+            if (len < 16){ // shorter than a vector, not worth an indirect call
+                for (size_t i=0; i<len; i++)
+                    dst[i] ^= src[i];
+                return;
+            }
+            xor_kernel().xor_into(dst, src, len);
+        }
+
+        // dst ^= srcs[0] ^ ... ^ srcs[count-1]  (dst is loaded and stored once per vector)
+        inline void xor_acc(uint8_t *dst, const uint8_t *const *srcs, size_t count, size_t len){
+            if (len < 16){
+                for (size_t s=0; s<count; s++)
+                    for (size_t i=0; i<len; i++)
+                        dst[i] ^= srcs[s][i];
+                return;
+            }
+            xor_kernel().xor_acc(dst, srcs, count, len);
+        }
+    }
+
+    /*
+    runs the parity of large blocks as tasks over byte ranges of the blocks
+    (all blocks of a group are XORed at the same offsets, so the ranges are independent).
+    run(ctx, n, task, arg) calls task(arg, begin, end) on sub-ranges covering [0, n)
+    and returns when all of them are done. see WorkStealingPool in RPPP_parallel.hpp.
+    */
+    struct ColumnSplitter{
+        void (*run)(void *ctx, size_t n, void (*task)(void*, size_t, size_t), void *arg) = nullptr;
+        void *ctx = nullptr;
+        size_t min_bytes = 0;   // blocks smaller than this are not split
+
+        bool splits(size_t block_bytes) const{
+            return run != nullptr && block_bytes >= min_bytes;
+        }
+    };
+
     enum Status{
         OK,
         OK_PARITY_GENERATED,
         NO_ELEMENT,
+        BUFFER_FULL,
+        LOST,
+        INVALID_ARGUMENT,
+        IO_ERROR,           // see errno (RPPP_udp.hpp)
+    };
+
+    /*
+    view of a contiguous array (std::span is c++20)
+    */
+    template<class T>
+    class span{
+        T *m_data;
+        size_t m_size;
+
+    public:
+        constexpr span() : m_data(nullptr), m_size(0){}
+        constexpr span(T *data, size_t size) : m_data(data), m_size(size){}
+        template<size_t N>
+        constexpr span(T (&array)[N]) : m_data(array), m_size(N){}
+        // std::vector, std::array, span<non-const T>, ...
+        template<class C, class = decltype(std::declval<C&>().data()), class = decltype(std::declval<C&>().size())>
+        constexpr span(C &c) : m_data(c.data()), m_size(c.size()){}
+
+        constexpr T* data() const{ return m_data; }
+        constexpr size_t size() const{ return m_size; }
+        constexpr bool empty() const{ return m_size == 0; }
+        constexpr T& operator[](size_t i) const{ return m_data[i]; }
+        constexpr T* begin() const{ return m_data; }
+        constexpr T* end() const{ return m_data + m_size; }
+        constexpr span subspan(size_t offset, size_t count = std::numeric_limits<size_t>::max()) const{
+            return span(m_data + offset, std::min(count, m_size - offset));
+        }
     };
 
     using seq_id_t = uint16_t;
+
+    // seq_id wraps at a multiple of the group size (parity_size+2)
+    constexpr int seq_id_wrap(int parity_size){
+        return multi_floor(std::numeric_limits<seq_id_t>::max(), parity_size+2);
+    }
+
+    /*
+    packet header layouts (H of StreamData, EncodeBuffer and DecodeBuffer)
+
+    a layout has `epoch` and `lane`, and tells the group and the position of a packet:
+        groups<parity_size>()       : group numbers before the wrap
+        advance<parity_size>()      : to the next packet (encoder)
+        group<parity_size>()        : group number (wrapped)
+        position<parity_size>()     : 0 .. parity_size-1 data, parity_size P, parity_size+1 Q
+        distance<parity_size>(base) : group number - base, where base is unwrapped (signed)
+    */
+
+    // 4 bytes. seq_id wraps at seq_id_wrap(parity_size) packets (about 21000 groups of 2)
     struct Header{
         seq_id_t seq_id;
+        uint8_t epoch;      // incremented by the encoder's reset()
+        uint8_t lane;       // parity group lane of InterleaveEncoder (0 otherwise)
+
+        template<int parity_size>
+        static constexpr int64_t groups(){
+            return seq_id_wrap(parity_size)/(parity_size+2);
+        }
+        template<int parity_size>
+        inline void advance(){
+            seq_id++;
+            if (seq_id == seq_id_wrap(parity_size))
+                seq_id = 0;
+        }
+        template<int parity_size>
+        inline int64_t group() const{
+            return seq_id/(parity_size+2);
+        }
+        template<int parity_size>
+        inline int position() const{
+            return seq_id%(parity_size+2);
+        }
+        template<int parity_size>
+        inline int64_t distance(int64_t base) const{
+            constexpr int64_t n = groups<parity_size>();
+            int64_t diff = (group<parity_size>() - base%n + n)%n;
+            return (diff >= n/2) ? diff - n : diff;
+        }
+    };
+
+    // 8 bytes. 32bit group number and the position: no division on the decoder,
+    // and a stream of 1M packets/s wraps after days
+    struct GroupHeader{
+        uint32_t group_id;
+        uint16_t pos;
+        uint8_t epoch;
+        uint8_t lane;
+
+        template<int parity_size>
+        static constexpr int64_t groups(){
+            return int64_t(1) << 32;
+        }
+        template<int parity_size>
+        inline void advance(){
+            if (++pos == parity_size+2){
+                pos = 0;
+                group_id++;
+            }
+        }
+        template<int parity_size>
+        inline int64_t group() const{
+            return group_id;
+        }
+        template<int parity_size>
+        inline int position() const{
+            return pos;
+        }
+        template<int parity_size>
+        inline int64_t distance(int64_t base) const{
+            return static_cast<int32_t>(group_id - static_cast<uint32_t>(base));
+        }
     };
 
-    template<class T, int block_num>
+    template<class T, int block_num, class H = Header>
     struct StreamData{
-        Header header;
-        uint8_t data[multi_ceil(sizeof(T), block_num)]; 
-        // (e.g. if block_num==4 then 6->8, 21->24, 16->16)
+        H header;
+        uint8_t data[multi_ceil(sizeof(T), padded_size(block_num))]; 
+        // (e.g. if block_num==4 then 6->8, 21->24, 16->16. block_num==8 has 10 blocks: 21->30)
+    };
+
+    // size of x without the trailing zero bytes (a word at a time)
+    inline size_t trim_zeros(const uint8_t *x, size_t size){
+        for (uint64_t w; size >= 8; size -= 8){
+            memcpy(&w, x + size - 8, sizeof(w));
+            if (w)
+                break;
+        }
+        while (size > 0 && x[size-1] == 0)
+            size--;
+        return size;
+    }
+
+    // bytes of the packet to send, without the trailing zeros of the data
+    // (zero padded items: Delta<T>, partial Batch<T, K>)
+    template<class SD>
+    inline size_t wire_size(const SD &sd){
+        return offsetof(SD, data) + trim_zeros(reinterpret_cast<const uint8_t*>(sd.data), sizeof(sd.data));
+    }
+
+    // a received packet of wire_size() bytes. false if it is not a packet of SD
+    template<class SD>
+    inline bool from_wire(const void *buf, size_t len, SD *sd){
+        if (len < offsetof(SD, data) || len > sizeof(SD))
+            return false;
+        memcpy(sd, buf, len);
+        memset(reinterpret_cast<uint8_t*>(sd) + len, 0, sizeof(SD) - len);
+        return true;
+    }
+
+    /*
+    fixed capacity ring buffer
+
+    the storage is a member array, so push/pop never allocate.
+    capacity 0: the storage is allocated once by resize() (runtime sized codecs)
+    */
+    template<class T, size_t capacity>
+    class RingBuffer{
+        typename std::conditional<capacity == 0, std::vector<T>, std::array<T, capacity>>::type m_buf;
+        size_t m_head;
+        size_t m_size;
+
+    public:
+        RingBuffer() : m_head(0), m_size(0){}
+
+        // (capacity 0) allocate n slots of init, and clear
+        void resize(size_t n, const T &init = T()){
+            m_buf.assign(n, init);
+            clear();
+        }
+
+        bool push(const T &item){
+            if (full())
+                return false;
+            push_back() = item;
+            return true;
+        }
+
+        // append a slot and return it. (must not be full)
+        T& push_back(){
+            size_t tail = m_head + m_size;
+            if (tail >= m_buf.size())
+                tail -= m_buf.size();
+            m_size++;
+            return m_buf[tail];
+        }
+
+        T& front(){
+            return m_buf[m_head];
+        }
+        T& back(){
+            size_t tail = m_head + m_size - 1;
+            if (tail >= m_buf.size())
+                tail -= m_buf.size();
+            return m_buf[tail];
+        }
+        const T& front() const{
+            return m_buf[m_head];
+        }
+
+        void pop(){
+            m_head++;
+            if (m_head == m_buf.size())
+                m_head = 0;
+            m_size--;
+        }
+
+        // move up to n items from the front to out. returns the number of moved items.
+        size_t pop_to(T *out, size_t n){
+            n = std::min(n, m_size);
+            size_t first = std::min(n, m_buf.size() - m_head);
+            std::copy(m_buf.begin() + m_head, m_buf.begin() + m_head + first, out);
+            std::copy(m_buf.begin(), m_buf.begin() + (n - first), out + first);
+            m_head += n;
+            if (m_head >= m_buf.size())
+                m_head -= m_buf.size();
+            m_size -= n;
+            return n;
+        }
+
+        void clear(){
+            m_head = 0;
+            m_size = 0;
+        }
+
+        size_t size() const{
+            return m_size;
+        }
+        size_t free() const{
+            return m_buf.size() - m_size;
+        }
+        bool empty() const{
+            return m_size == 0;
+        }
+        bool full() const{
+            return m_size == m_buf.size();
+        }
     };
 
-    template<class T, int parity_size, size_t bytes = multi_ceil(sizeof(T), parity_size)>
+    /*
+    runtime statistics (RPPP_STATS=1)
+
+    the data path is the only writer, so the counters are relaxed atomics
+    updated without a locked instruction, and stats() can be read from another
+    thread at any time. (each value is exact, but the values are not a
+    consistent cut of each other)
+    with RPPP_STATS=0 every type below is empty and the updates compile to nothing.
+    */
+    namespace stats{
+        // log-linear buckets (HDR style): 16 buckets per power of two, < 6.25% error.
+        // values of 2^40 ns (18 minutes) and more go to the last bucket.
+        constexpr int histogram_sub_bits = 4;
+        constexpr int histogram_buckets = (40 - histogram_sub_bits + 1) << histogram_sub_bits;
+
+        constexpr int bucket_of(uint64_t v){
+            if (v < (1u << histogram_sub_bits))
+                return static_cast<int>(v);
+            const int k = 63 - __builtin_clzll(v);
+            if (k >= 40)
+                return histogram_buckets - 1;
+            return ((k - histogram_sub_bits + 1) << histogram_sub_bits)
+                + static_cast<int>((v >> (k - histogram_sub_bits)) & ((1u << histogram_sub_bits) - 1));
+        }
+        // the smallest value of the bucket
+        constexpr uint64_t bucket_floor(int bucket){
+            if (bucket < (1 << histogram_sub_bits))
+                return bucket;
+            const int k = (bucket >> histogram_sub_bits) + histogram_sub_bits - 1;
+            const uint64_t sub = bucket & ((1 << histogram_sub_bits) - 1);
+            return ((1ull << histogram_sub_bits) + sub) << (k - histogram_sub_bits);
+        }
+
+        struct HistogramSnapshot{
+            std::array<uint64_t, histogram_buckets> counts {};
+
+            uint64_t count() const{
+                uint64_t n = 0;
+                for (uint64_t c : counts)
+                    n += c;
+                return n;
+            }
+            // the largest value of the bucket where q (0 .. 1) of the values are (0 if empty)
+            uint64_t percentile(double q) const{
+                const uint64_t n = count();
+                if (n == 0)
+                    return 0;
+                const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q*n + 0.5));
+                uint64_t seen = 0;
+                for (int b=0; b<histogram_buckets; b++){
+                    seen += counts[b];
+                    if (seen >= rank)
+                        return (b+1 < histogram_buckets) ? bucket_floor(b+1) - 1 : bucket_floor(b);
+                }
+                return bucket_floor(histogram_buckets-1);
+            }
+        };
+
+    #if RPPP_STATS
+        class Counter{
+            std::atomic<uint64_t> m_value {0};
+
+        public:
+            inline void add(uint64_t n = 1){
+                m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+            uint64_t load() const{
+                return m_value.load(std::memory_order_relaxed);
+            }
+        };
+
+        class Histogram{
+            std::array<std::atomic<uint64_t>, histogram_buckets> m_counts {};
+
+        public:
+            inline void record(uint64_t v){
+                std::atomic<uint64_t>& c = m_counts[bucket_of(v)];
+                c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            inline void record(std::chrono::steady_clock::duration d){
+                record(static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count())));
+            }
+            HistogramSnapshot snapshot() const{
+                HistogramSnapshot s;
+                for (int b=0; b<histogram_buckets; b++)
+                    s.counts[b] = m_counts[b].load(std::memory_order_relaxed);
+                return s;
+            }
+        };
+
+        // records the time of a scope
+        class Timer{
+            Histogram& m_histogram;
+            std::chrono::steady_clock::time_point m_start;
+
+        public:
+            explicit Timer(Histogram& histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()){}
+            ~Timer(){
+                m_histogram.record(std::chrono::steady_clock::now() - m_start);
+            }
+        };
+    #else
+        class Counter{
+        public:
+            inline void add(uint64_t = 1){}
+            uint64_t load() const{ return 0; }
+        };
+
+        class Histogram{
+        public:
+            inline void record(uint64_t){}
+            inline void record(std::chrono::steady_clock::duration){}
+            HistogramSnapshot snapshot() const{ return {}; }
+        };
+
+        class Timer{
+        public:
+            explicit Timer(Histogram&){}
+        };
+    #endif
+
+        struct EncodeStats{
+            Counter items;          // enqueued items
+            Counter packets;        // output packets (data + P + Q)
+            Counter groups;         // parity groups
+            Counter buffer_full;    // enq() refused by BUFFER_FULL
+
+            struct Snapshot{
+                uint64_t items;
+                uint64_t packets;
+                uint64_t groups;
+                uint64_t buffer_full;
+            };
+            Snapshot snapshot() const{
+                return {items.load(), packets.load(), groups.load(), buffer_full.load()};
+            }
+        };
+
+        struct DecodeStats{
+            Counter packets;        // accepted packets
+            Counter duplicates;
+            Counter stale;          // packets of a closed group (also unneeded parity) or an old epoch
+            Counter resets;         // restarts by a new epoch
+            Counter groups_clean;   // all data received
+            Counter groups_p;       // a data packet recovered from P
+            Counter groups_pq;      // recovered from P and Q (the diagonal)
+            Counter groups_lost;    // given up with lost data (3 or more lost, window or deadline)
+            Counter items;          // output items
+            Counter items_recovered;
+            Counter items_lost;     // Status::LOST items
+            Counter output_dropped; // discarded by the full output (BUFFER_FULL)
+            Histogram latency;      // packet arrival (group's first packet if recovered) -> output, ns
+            Histogram decode_time;  // time of a recovery, ns
+
+            struct Snapshot{
+                uint64_t packets;
+                uint64_t duplicates;
+                uint64_t stale;
+                uint64_t resets;
+                uint64_t groups_clean;
+                uint64_t groups_p;
+                uint64_t groups_pq;
+                uint64_t groups_lost;
+                uint64_t items;
+                uint64_t items_recovered;
+                uint64_t items_lost;
+                uint64_t output_dropped;
+                HistogramSnapshot latency;
+                HistogramSnapshot decode_time;
+            };
+            Snapshot snapshot() const{
+                return {packets.load(), duplicates.load(), stale.load(), resets.load(),
+                    groups_clean.load(), groups_p.load(), groups_pq.load(), groups_lost.load(),
+                    items.load(), items_recovered.load(), items_lost.load(), output_dropped.load(),
+                    latency.snapshot(), decode_time.snapshot()};
+            }
+        };
+    }
+
+    /*
+    P/Q parity geometry (shared by EncodeBuffer / DecodeBuffer, VarEncodeBuffer /
+    VarDecodeBuffer and FragmentEncoder / FragmentDecoder)
+
+    a group has n columns of n blocks (n+1 prime): data columns 0..k-1, the
+    virtual zero columns k..n-1 (neither stored nor xored) and P = column n.
+    block (c, r) lies on the diagonal (c-r)%(n+1). Q has the blocks of the
+    diagonals 0..n-1 (the diagonal n is not sent), and row n is an imaginary
+    zero row.
+    */
+    namespace pq{
+
+        /*
+        Q accumulation
+
+        the encoder keeps Q in reversed diagonal order (slot = n - diagonal,
+        slot 0 = the diagonal which is not sent), so the blocks of column c land
+        on at most two contiguous runs of slots:
+            blocks [0, head)    -> slots [n-c, n-c+head)    (head = min(c+1, n))
+            blocks [head, n)    -> slots [0, n-head)
+        block j of the Q packet is slot n-j.
+        */
+        constexpr int q_slot(int n, int c, int r){
+            return n - (c-r+n+1)%(n+1);
+        }
+
+        // slots (n+1 blocks) ^= column c
+        inline void accumulate_q(uint8_t *slots, int n, int c, const uint8_t *column, size_t block){
+            const int head = std::min(c+1, n);
+            simd::xor_into(slots + (n-c)*block, column, head*block);
+            simd::xor_into(slots, column + head*block, (n-head)*block);
+        }
+
+        /*
+        two erasure recovery schedule
+
+        when the columns a < b are lost, blocks are recovered in pairs:
+        one block from the diagonal parity, then the other lost block of the same
+        row from the horizonal parity. the order of the rows only depends on
+        delta = b-a:
+            row k = ((k+1)*delta - 1) % (n+1)
+        let m = the k of the row (a+1)%(n+1) (-1 for the imaginary row),
+            k = 0 .. m          : b from the diagonal, a from the row
+            k = n-1 .. m+1      : a from the diagonal, b from the row
+
+        pos[delta*(n+1) + r] is the k of row r ((n+1)*(n+1) entries)
+        */
+        constexpr void fill_schedule(int n, int16_t *pos){
+            for (int delta=1; delta<n+1; delta++){
+                for (int k=0; k<n; k++)
+                    pos[delta*(n+1) + ((k+1)*delta - 1) % (n+1)] = static_cast<int16_t>(k);
+                pos[delta*(n+1) + n] = -1;
+            }
+        }
+
+        // the columns of a group in memory
+        struct Columns{
+            uint8_t *data;      // data column c at data + c*stride
+            size_t stride;
+            uint8_t *p;
+            const uint8_t *q;   // diagonal d at q + d*block
+            size_t block;       // bytes of a block
+            int n;              // columns of the geometry
+            int k;              // stored data columns
+
+            inline uint8_t* block_of(int c, int r) const{
+                return (c == n ? p : data + c*stride) + r*block;
+            }
+        };
+
+        /*
+        recovery of lost columns. max_k is the largest k of the caller (the size
+        of the source arrays).
+        */
+
+        // block (c, r) = xor of the other blocks of row r. bytes [begin, end) of the blocks
+        template<int max_k>
+        inline void recover_from_row(const Columns& g, int c, int r, size_t begin, size_t end){
+            const size_t offset = r*g.block + begin;
+            std::array<const uint8_t*, max_k+1> src;
+            int src_num = 0;
+            const uint8_t *column = g.data;
+            for (int i=0; i<g.k; i++, column += g.stride){
+                if (i != c)
+                    src[src_num++] = column + offset;
+            }
+            if (c != g.n)
+                src[src_num++] = g.p + offset;
+            memset(g.block_of(c, r) + begin, 0, end - begin);
+            simd::xor_acc(g.block_of(c, r) + begin, src.data(), src_num, end - begin);
+        }
+
+        // block (c, r) = Q[d] xor the other blocks of the diagonal d
+        template<int max_k>
+        inline void recover_from_diagonal(const Columns& g, int c, int r, size_t begin, size_t end){
+            const int n = g.n;
+            int d = c - r;              // (c-r)%(n+1) without a division
+            if (d < 0)
+                d += n+1;
+            std::array<const uint8_t*, max_k+2> src;
+            int src_num = 0;
+            src[src_num++] = g.q + d*g.block + begin;
+            int row = d ? n+1-d : 0;    // row of column 0 on the diagonal d
+            const uint8_t *column = g.data + begin;
+            for (int i=0; i<g.k; i++, row++, column += g.stride){
+                if (row == n+1)
+                    row = 0;
+                if (i != c && row != n) // the diagonal has no block in row n
+                    src[src_num++] = column + row*g.block;
+            }
+            const int p_row = n - d;    // row of P on the diagonal d
+            if (c != n && p_row != n)
+                src[src_num++] = g.p + p_row*g.block + begin;
+            memset(g.block_of(c, r) + begin, 0, end - begin);
+            simd::xor_acc(g.block_of(c, r) + begin, src.data(), src_num, end - begin);
+        }
+
+        // data column c = xor of the other data columns and P (in one pass over the columns)
+        template<int max_k>
+        inline void recover_column(const Columns& g, int c){
+            if (c == g.n)
+                return; // P only
+            std::array<const uint8_t*, max_k+1> src;
+            int src_num = 0;
+            for (int i=0; i<g.k; i++){
+                if (i != c)
+                    src[src_num++] = g.block_of(i, 0);
+            }
+            src[src_num++] = g.p;
+            memset(g.block_of(c, 0), 0, g.n*g.block);
+            simd::xor_acc(g.block_of(c, 0), src.data(), src_num, g.n*g.block);
+        }
+
+        // columns a < b of the geometry, m from the schedule. bytes [begin, end) of the blocks
+        template<int max_k>
+        inline void recover_pair(const Columns& g, int a, int b, int m, size_t begin, size_t end){
+            const int n = g.n;
+            const int delta = b - a;
+            int r = delta - 1;          // row 0 of the schedule
+            for (int k=0; k<=m; k++){
+                recover_from_diagonal<max_k>(g, b, r, begin, end);
+                recover_from_row<max_k>(g, a, r, begin, end);
+                if ((r += delta) > n)
+                    r -= n+1;
+            }
+            r = n - delta;              // row n-1 of the schedule
+            for (int k=n-1; k>m; k--){
+                recover_from_diagonal<max_k>(g, a, r, begin, end);
+                recover_from_row<max_k>(g, b, r, begin, end);
+                if ((r -= delta) < 0)
+                    r += n+1;
+            }
+        }
+    }
+
+    // pq::fill_schedule() of a compile-time geometry
+    template<int n>
+    struct RecoverySchedule{
+        std::array<int16_t, (n+1)*(n+1)> pos {};
+
+        constexpr RecoverySchedule(){
+            pq::fill_schedule(n, pos.data());
+        }
+        // m of the lost columns a < b
+        constexpr int mid(int a, int b) const{
+            return pos[(b-a)*(n+1) + (a+1)%(n+1)];
+        }
+    };
+
+    /*
+    any parity_size >= 2: the parity is computed over padded = padded_size(parity_size)
+    columns, and the virtual zero columns parity_size..padded-1 are skipped.
+    an item has `padded` blocks, and a group is parity_size + 2 packets.
+    */
+    template<class T, int parity_size, class H = Header>
     class EncodeBuffer{
-        static_assert(is_prime(parity_size+1), "n + 1 is must be prime.");
+        static_assert(parity_size+2 <= std::numeric_limits<uint16_t>::max(), "n is too large.");
         static_assert(parity_size >= 2, "n must be >= 2.");
         static_assert(std::is_pod<T>::value, "T must be a POD type.");
-        using Block = std::array<uint8_t, bytes/parity_size>;
-        using Blocks = std::array<Block, parity_size>;
-        using Stream = std::pair<Header, Blocks>;
-        std::vector<Blocks> m_inBuf;
-        std::queue<Stream> m_outBuf;
-        seq_id_t m_seqId;
+        static constexpr int padded = padded_size(parity_size);
+        static constexpr size_t bytes = multi_ceil(sizeof(T), padded);
+        using Block = std::array<uint8_t, bytes/padded>;
+        using Blocks = std::array<Block, padded>;
+        alignas(64) Blocks m_p;                     // running horizonal parity
+        alignas(64) std::array<Block, padded+1> m_q; // running diagonal parity (see pq::accumulate_q)
+        int m_count;                                // items of the current group
+        RingBuffer<StreamData<T, parity_size, H>, parity_size+2> m_outBuf; // a group (data + P + Q)
+        H m_header;                                 // of the next packet
+        ColumnSplitter m_splitter;
+        stats::EncodeStats m_stats;
 
     public:
-        EncodeBuffer() : m_seqId(0){}
+        EncodeBuffer() : m_p{}, m_q{}, m_count(0), m_header{}{}
+
+        // tags the packets with the lane (used by InterleaveEncoder)
+        void set_lane(uint8_t lane){
+            m_header.lane = lane;
+        }
+
+        // compute the parity of large items in tasks
+        void set_splitter(const ColumnSplitter& splitter){
+            m_splitter = splitter;
+        }
 
         Status enq(const T &item){
-            Blocks blocks {};
-            memcpy(blocks.data(), &item, sizeof(T));
-
-            m_inBuf.push_back(blocks);
-            push2outbuf(blocks);
-
-            if (m_inBuf.size() == parity_size){
-                // P parity
-                // horizonal parity
-                Blocks p {};
-                for (int i=0; i<parity_size; i++){
-                    for (int j=0; j<parity_size; j++){                   
-                        p[j] = block_xor(p[j], m_inBuf[i][j]);
-                    }
-                }
-                push2outbuf(p);
-
-                // Q parity
-                // diagonal parity
-                /*
-                example: parity_size = 4
-
-                a b c d p  q
-                ---------- -
-                0 1 2 3    0
-                  0 1 2 3  1
-                3   0 1 2  2
-                2 3   0 1  3
-
-                q0 = a0 xor b0 xor c0 xor d0
-                q1 = b1 xor c1 xor d1 xor p1
-                */
-                m_inBuf.push_back(p);
-                Blocks q {};
-                for (int j=0; j<parity_size; j++){
-                    for (int i=0; i<parity_size; i++){              
-                        q[j] = block_xor(q[j], m_inBuf[(i+j)%(parity_size+1)][i]);
-                    }
+            if (m_outBuf.free() < free_needed()){
+                m_stats.buffer_full.add();
+                return Status::BUFFER_FULL;
+            }
+            return encode(item);
+        }
+
+        // enqueue items until the output is full. returns the number of enqueued items.
+        size_t enq_batch(span<const T> items){
+            size_t i = 0;
+            while (i < items.size()){
+                // items which fit in the output without checking each of them
+                size_t free = m_outBuf.free();
+                size_t n = 0;
+                for (int count=m_count; n < items.size()-i; n++, count++){
+                    size_t needed = (count%parity_size == parity_size-1) ? 3 : 1;
+                    if (free < needed)
+                        break;
+                    free -= needed;
                 }
-                push2outbuf(q);
-                
-                m_inBuf.clear();
+                if (n == 0)
+                    break;
+                for (size_t end=i+n; i<end; i++)
+                    encode(items[i]);
+            }
+            return i;
+        }
+
+        // dequeue packets into a contiguous array. returns the number of packets.
+        size_t drain(span<StreamData<T, parity_size, H>> out){
+            return m_outBuf.pop_to(out.data(), out.size());
+        }
+
+    private:
+        inline size_t free_needed() const{
+            // the last item of a group also emits P and Q
+            return (m_count == parity_size-1) ? 3 : 1;
+        }
+
+        inline Status encode(const T &item){
+            StreamData<T, parity_size, H>& sd = push_header();
+            memcpy(sd.data, &item, sizeof(T));
+            memset(sd.data + sizeof(T), 0, bytes - sizeof(T));
+
+            // P parity (horizonal) and Q parity (diagonal)
+            /*
+            example: parity_size = 4
+
+            a b c d p  q
+            ---------- -
+            0 1 2 3    0
+              0 1 2 3  1
+            3   0 1 2  2
+            2 3   0 1  3
+
+            q0 = a0 xor b0 xor c0 xor d0
+            q1 = b1 xor c1 xor d1 xor p1
+            */
+            if (m_splitter.splits(sizeof(Block))){
+                accumulate_split(m_count, sd.data, true);
+            }
+            else{
+                simd::xor_into(bytes_of(m_p), sd.data, bytes);
+                accumulate_q(m_count, sd.data);
+            }
+            m_count++;
+            m_stats.items.add();
+
+            if (m_count == parity_size){
+                push2outbuf(m_p);
+
+                // P is the column `padded` of the geometry
+                if (m_splitter.splits(sizeof(Block)))
+                    accumulate_split(padded, bytes_of(m_p), false);
+                else
+                    accumulate_q(padded, bytes_of(m_p));
+                StreamData<T, parity_size, H>& q = push_header();
+                for (int j=0; j<padded; j++)
+                    memcpy(q.data + j*sizeof(Block), m_q[padded-j].data(), sizeof(Block));
+
+                clear_group();
+                m_stats.groups.add();
                 return Status::OK_PARITY_GENERATED;
             }
             return Status::OK;
         }
 
-        Status deq(StreamData<T, parity_size>* psd){
-            if(m_outBuf.size() == 0)
+    public:
+
+        Status deq(StreamData<T, parity_size, H>* psd){
+            if(m_outBuf.empty())
                 return Status::NO_ELEMENT;
             
-            psd->header = m_outBuf.front().first;
-            memcpy(&(psd->data), m_outBuf.front().second.data(), bytes);
+            *psd = m_outBuf.front();
             m_outBuf.pop();
             
             return Status::OK;
         }
 
+        // front of the output without copy. (nullptr if empty)
+        // valid until the next pop(), enq() or reset().
+        const StreamData<T, parity_size, H>* peek() const{
+            if(m_outBuf.empty())
+                return nullptr;
+            return &m_outBuf.front();
+        }
+
+        Status pop(){
+            if(m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
         void reset(){
-            m_inBuf.clear();
-            std::queue<Stream> empty;
-            std::swap(empty, m_outBuf);
-            m_seqId = 0;
+            clear_group();
+            m_outBuf.clear();
+            H header {};
+            header.epoch = m_header.epoch + 1; // the decoder restarts at the new epoch
+            header.lane = m_header.lane;
+            m_header = header;
         }
 
         size_t count(){
             return m_outBuf.size();
         }
 
+        // counters (zero without RPPP_STATS). safe to call from another thread.
+        stats::EncodeStats::Snapshot stats() const{
+            return m_stats.snapshot();
+        }
+
     private:
-        inline void push2outbuf(Blocks blocks){
-            Header h;
-            h.seq_id = m_seqId;
-            m_seqId++;
-            if (m_seqId == multi_floor(std::numeric_limits<seq_id_t>::max(), parity_size+2))
-                m_seqId = 0;
-
-            Stream st;
-            st.first = h;
-            st.second = blocks;
-            m_outBuf.push(st);
-        }
-        inline Block block_xor(const Block& lhs, const Block& rhs){
-            Block ret;
-            for(int i=0; i<static_cast<int>(ret.size()); i++)
-                ret[i] = lhs[i] xor rhs[i];
-            return ret;
+        inline StreamData<T, parity_size, H>& push_header(){
+            StreamData<T, parity_size, H>& sd = m_outBuf.push_back();
+            m_stats.packets.add();
+            sd.header = m_header;
+            m_header.template advance<parity_size>();
+            return sd;
+        }
+        inline void push2outbuf(const Blocks& blocks){
+            memcpy(push_header().data, bytes_of(blocks), bytes);
+        }
+        inline void accumulate_q(int c, const uint8_t *data){
+            pq::accumulate_q(m_q[0].data(), padded, c, data, sizeof(Block));
+        }
+        // accumulate_q (and P) of column c in tasks over byte ranges of the blocks
+        inline void accumulate_split(int c, const uint8_t *data, bool with_p){
+            struct Task{
+                EncodeBuffer *self;
+                int c;
+                const uint8_t *data;
+                bool with_p;
+            } task {this, c, data, with_p};
+            m_splitter.run(m_splitter.ctx, sizeof(Block), [](void *arg, size_t begin, size_t end){
+                const Task& t = *static_cast<Task*>(arg);
+                for (int i=0; i<padded; i++){
+                    const uint8_t *src = t.data + i*sizeof(Block) + begin;
+                    if (t.with_p)
+                        simd::xor_into(t.self->m_p[i].data() + begin, src, end - begin);
+                    simd::xor_into(t.self->m_q[pq::q_slot(padded, t.c, i)].data() + begin, src, end - begin);
+                }
+            }, &task);
+        }
+        inline void clear_group(){
+            m_p = {};
+            m_q = {};
+            m_count = 0;
+        }
+        static inline uint8_t* bytes_of(Blocks& blocks){
+            return blocks.data()->data();
+        }
+        static inline const uint8_t* bytes_of(const Blocks& blocks){
+            return blocks.data()->data();
         }
     };
 
-    template<class T, int parity_size, size_t bytes = multi_ceil(sizeof(T), parity_size)>
-    class DecodeBuffer{
-        static_assert(is_prime(parity_size+1), "n + 1 must be prime.");
-        static_assert(parity_size >= 2, "n must be >= 2.");
-        static_assert(std::is_pod<T>::value, "T must be a POD type.");
-        using Block = std::array<uint8_t, bytes/parity_size>;
-        using Blocks = std::array<Block, parity_size>;
-        using Stream = std::pair<Header, Blocks>;
-        std::vector<Stream> m_inBuf;
-        std::queue<Blocks> m_outBuf;
-        seq_id_t m_expectSeqId;
-        seq_id_t m_nextSeqIdFloor;
-        seq_id_t m_prevSeqId;
-        uint8_t m_lossCnt;
+    /*
+    the packets of a parity group as one matrix
+
+    columns (data, P, Q) of `bytes` each in one array. each column starts on a
+    cache line (the stride is padded to 64 bytes): a column is one aligned
+    stream for the xor kernels, and block r of every column is `stride` apart.
+    */
+    template<int columns, size_t bytes>
+    struct GroupMatrix{
+        static constexpr size_t line = 64;
+        static constexpr size_t stride = (bytes + line - 1)/line*line;
+        alignas(line) std::array<uint8_t, columns*stride> cells;
+
+        inline uint8_t* column(int c){
+            return cells.data() + c*stride;
+        }
+        inline const uint8_t* column(int c) const{
+            return cells.data() + c*stride;
+        }
+    };
+
+    // output order of DecodeBuffer
+    enum Delivery{
+        IN_ORDER,   // data in sequence order (default)
+        EARLY,      // received data at once, recovered data when it is recovered
+    };
+
+    // position of a decoded item
+    struct ItemInfo{
+        uint64_t index;     // item number in the epoch (group number * parity_size + position)
+        uint64_t lost;      // number of given up items from index (Status::LOST)
+        bool recovered;     // restored from the parity
+    };
+
+    // state of a group in ReorderWindow. Flags: the data positions, then the parity
+    template<class Flags>
+    struct WindowGroup{
+        Flags received;
+        Flags output;
+        int received_cnt;
+        int output_cnt;
+        int next;           // IN_ORDER: first data not output
+        bool decoded;       // all data is available
+        bool used;
+        int64_t number;
+    };
+
+    /*
+    reorder window of parity groups and the output queue of a decoder
+    (DecodeBuffer, RsDecodeBuffer, VarDecodeBuffer)
+
+    the window holds the groups [m_base, m_base + reorder groups) of the current
+    epoch, indexed by group number % reorder groups. the data of the oldest groups
+    is output in order, and the groups which fall out of the window are given up.
+    the output queue has the items and the given up ranges (Status::LOST entries).
+
+    Codec derives from ReorderWindow<Codec, Groups, Item, capacity> (Groups: the
+    container of its groups, WindowGroup or derived. Item: the data of an output
+    entry), decodes its groups, and has
+        int group_items() const                                     : data items of a group
+        void write(Item& item, const Group& g, int pos, bool recovered) : item pos of the group
+    a codec may hide output() to check an item before it is written (see VarDecodeBuffer).
+    capacity 0: the codec sizes m_window and m_outBuf in its constructor.
+    */
+    template<class Codec, class Groups, class Item, size_t capacity>
+    class ReorderWindow{
+    protected:
+        using Group = typename Groups::value_type;
+        struct Output{
+            Item item;
+            ItemInfo info;
+        };
+        Groups m_window;                                // indexed by group number % reorder groups
+        int64_t m_base;                                 // group number of the oldest group in the window
+        uint8_t m_epoch;
         bool m_flag_first_call;
+        Delivery m_delivery;
+        RingBuffer<Output, capacity> m_outBuf;
+        size_t m_outGaps;                               // Status::LOST entries in m_outBuf
+        size_t m_outDropped;
+        stats::DecodeStats m_stats;
 
-    public:
-        DecodeBuffer() :
-            m_expectSeqId(0),
-            m_nextSeqIdFloor(parity_size+2),
-            m_prevSeqId(0),
-            m_lossCnt(0),
-            m_flag_first_call(true)
+        ReorderWindow() :
+            m_window{},
+            m_base(0),
+            m_epoch(0),
+            m_flag_first_call(true),
+            m_delivery(Delivery::IN_ORDER),
+            m_outGaps(0),
+            m_outDropped(0)
         {}
 
-        Status enq(const StreamData<T, parity_size> &sd){
-            Stream stream;
-            stream.first = sd.header;
-            memcpy(stream.second.data(), sd.data, sizeof(sd.data));
+    public:
+        void reset(){
+            for (auto& g : m_window)
+                g.used = false;
+            m_outBuf.clear();
+            m_outGaps = 0;
+            m_base = 0;
+            m_epoch = 0;
+            m_flag_first_call = true;
+        }
+
+        // give up all groups in flight (e.g. at the end of the stream)
+        void finish(){
+            if (not m_flag_first_call)
+                flush(last_used() + 1);
+        }
+
+        // parity groups in the window
+        size_t in_flight() const{
+            size_t n = 0;
+            for (auto& g : m_window)
+                n += g.used;
+            return n;
+        }
+
+        // number of items (given up items are not counted)
+        size_t count(){
+            return m_outBuf.size() - m_outGaps;
+        }
+
+    protected:
+        inline Codec& codec(){
+            return static_cast<Codec&>(*this);
+        }
+        inline int window_groups() const{
+            return static_cast<int>(m_window.size());
+        }
 
-            // for encoder's reset
-            if (stream.first.seq_id <= m_prevSeqId && not m_flag_first_call)
+        /*
+        the group number of a packet of the group `group` (wrapped) in `epoch`.
+        distance(m_base) is the group number - m_base. a new epoch (encoder's reset)
+        gives up the groups of the old one, and a packet ahead of the window gives up
+        the oldest groups. -1: a delayed packet of an old epoch or a closed group
+        */
+        template<class Distance>
+        inline int64_t admit(uint8_t epoch, int64_t group, Distance distance){
+            if (m_flag_first_call)
             {
-                m_inBuf.clear();
-                m_expectSeqId = multi_floor(stream.first.seq_id, parity_size+2);
-                m_nextSeqIdFloor = multi_ceil(m_expectSeqId+1, parity_size+2);
-                m_prevSeqId = stream.first.seq_id;
-                m_lossCnt = 0;
-                m_flag_first_call = true;
-                enq(sd);
+                start(epoch, group);
             }
-            if (m_flag_first_call)
+            else if (epoch != m_epoch) // for encoder's reset
             {
-                m_flag_first_call = false;
+                if (static_cast<int8_t>(epoch - m_epoch) < 0){
+                    m_stats.stale.add();
+                    return -1; // delayed packet of an old epoch
+                }
+                flush(last_used() + 1);
+                start(epoch, group);
+                m_stats.resets.add();
             }
 
-            if(stream.first.seq_id == m_expectSeqId) // no lost
-            {
-                m_inBuf.push_back(stream);
-                if (m_lossCnt == 0)
-                    m_outBuf.push(stream.second);
-                m_expectSeqId = stream.first.seq_id+1;
+            // distance from the oldest group (the header wraps around)
+            const int64_t diff = distance(m_base);
+            if (diff < 0){ // expired group
+                m_stats.stale.add();
+                return -1;
             }
-            else if (stream.first.seq_id < m_expectSeqId) // expired sequence id
-            {
-                // NO OPERATION
+            const int64_t number = m_base + diff;
+            if (diff >= window_groups()) // give up the oldest groups
+                flush(number - window_groups() + 1);
+            return number;
+        }
+
+        inline Group& group_of(int64_t number){
+            return m_window[number%window_groups()];
+        }
+
+        inline void open(Group& g, int64_t number){
+            std::fill(g.received.begin(), g.received.end(), false);
+            std::fill(g.output.begin(), g.output.end(), false);
+            g.received_cnt = 0;
+            g.output_cnt = 0;
+            g.next = 0;
+            g.decoded = false;
+            g.used = true;
+            g.number = number;
+        }
+
+        inline void output(Group& g, int pos, bool recovered){
+            g.output[pos] = true;
+            g.output_cnt++;
+            if (m_outBuf.full()){
+                m_outDropped++;
+                m_stats.output_dropped.add();
+                return;
             }
-            else if(stream.first.seq_id > m_expectSeqId) // skipped sequence id
-            {
-                if(stream.first.seq_id >= m_nextSeqIdFloor) // next parity set
-                {
-                    next_period();
-                    enq(sd);
-                }
-                else if(stream.first.seq_id == m_expectSeqId + 1) // lost 1
-                {
-                    m_inBuf.push_back(stream);
-                    m_lossCnt += 1;
-                    m_expectSeqId = stream.first.seq_id+1;
+            Output& out = m_outBuf.push_back();
+            out.info = {static_cast<uint64_t>(g.number*codec().group_items() + pos), 0, recovered};
+            codec().write(out.item, g, pos, recovered);
+            m_stats.items.add();
+            m_stats.items_recovered.add(recovered);
+        }
+
+        // item pos of the group is given up
+        inline void output_lost(Group& g, int pos){
+            g.output[pos] = true;
+            g.output_cnt++;
+            output_gap(g.number*codec().group_items() + pos, 1);
+        }
+
+        // items [index, index+num) are given up
+        inline void output_gap(int64_t index, int64_t num){
+            m_stats.items_lost.add(num);
+            if (m_outGaps && m_outBuf.back().info.lost && m_outBuf.back().info.index + m_outBuf.back().info.lost == static_cast<uint64_t>(index)){
+                m_outBuf.back().info.lost += num;
+                return;
+            }
+            if (m_outBuf.full()){
+                m_outDropped++;
+                m_stats.output_dropped.add();
+                return;
+            }
+            Output& out = m_outBuf.push_back();
+            out.info = {static_cast<uint64_t>(index), static_cast<uint64_t>(num), false};
+            m_outGaps++;
+        }
+
+        // pop given up entries of the front. returns true if an item is at the front.
+        inline bool skip_gaps(){
+            while (not m_outBuf.empty() && m_outBuf.front().info.lost){
+                m_outBuf.pop();
+                m_outGaps--;
+            }
+            return not m_outBuf.empty();
+        }
+
+        // Status::LOST: pop the given up range at the front into *info.
+        // Status::OK: the item of *info is m_outBuf.front() (the caller pops it)
+        inline Status front(ItemInfo *info){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            *info = m_outBuf.front().info;
+            if (info->lost){
+                m_outBuf.pop();
+                m_outGaps--;
+                return Status::LOST;
+            }
+            return Status::OK;
+        }
+
+        inline void start(uint8_t epoch, int64_t group){
+            for (auto& g : m_window)
+                g.used = false;
+            m_epoch = epoch;
+            m_base = group;
+            m_flag_first_call = false;
+        }
+
+        inline int64_t last_used() const{
+            int64_t last = m_base - 1;
+            for (auto& g : m_window){
+                if (g.used)
+                    last = std::max(last, g.number);
+            }
+            return last;
+        }
+
+        // output data of the oldest groups in order, and close finished groups
+        inline void deliver(){
+            const int items = codec().group_items();
+            for (;;){
+                Group& g = group_of(m_base);
+                if (not g.used)
+                    return;
+                if (m_delivery == Delivery::IN_ORDER){
+                    for (; g.next < items && (g.decoded || g.received[g.next]); g.next++){
+                        if (not g.output[g.next])
+                            codec().output(g, g.next, not g.received[g.next]);
+                    }
                 }
-                else if(stream.first.seq_id == m_expectSeqId + 2) // lost 2
-                {
-                    m_inBuf.push_back(stream);
-                    m_lossCnt += 2;
-                    m_expectSeqId = stream.first.seq_id+1;
+                if (g.output_cnt < items)
+                    return;
+                g.used = false;
+                m_base++;
+            }
+        }
+
+        // close the group even if some data is lost
+        inline void give_up(Group& g){
+            if (not g.decoded)
+                m_stats.groups_lost.add();
+            for (int i=0; i<codec().group_items(); i++){
+                if (g.output[i])
+                    continue;
+                if (g.received[i] || g.decoded)
+                    codec().output(g, i, not g.received[i]);
+                else
+                    output_lost(g, i);
+            }
+            g.used = false;
+        }
+
+        // give up the groups before `until`
+        inline void flush(int64_t until){
+            const int items = codec().group_items();
+            for (int i=0; i<window_groups() && m_base < until; i++){
+                Group& g = group_of(m_base);
+                if (g.used){
+                    give_up(g);
                 }
-                else // lost >= 3
-                {
-                    m_lossCnt += 3;
+                else{
+                    m_stats.groups_lost.add();
+                    output_gap(m_base*items, items);
                 }
+                m_base++;
+                deliver();
+            }
+            if (m_base < until){ // no group left in the window
+                m_stats.groups_lost.add(until-m_base);
+                output_gap(m_base*items, (until-m_base)*items);
+                m_base = until;
             }
+            deliver();
+        }
+    };
 
-            if (m_lossCnt >= 3)
-            {
-                next_period();
+    /*
+    reorder_groups: number of parity groups in flight.
+    a group is decoded as soon as it is complete or recoverable, and given up
+    when a packet of the group reorder_groups ahead arrives, or when its deadline
+    (set_deadline(), from the first packet of the group) has passed.
+    */
+    template<class T, int parity_size, int reorder_groups = 2, class H = Header>
+    class DecodeBuffer : public ReorderWindow<DecodeBuffer<T, parity_size, reorder_groups, H>,
+                                              std::array<WindowGroup<std::array<bool, parity_size+2>>, reorder_groups>,
+                                              std::array<uint8_t, multi_ceil(sizeof(T), padded_size(parity_size))>,
+                                              parity_size*(reorder_groups+1)>{ // the whole window + a group
+        static_assert(parity_size >= 2, "n must be >= 2.");
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        static_assert(reorder_groups >= 1, "reorder_groups must be >= 1.");
+        static_assert(reorder_groups < H::template groups<parity_size>()/2, "reorder_groups is too large for the header.");
+        using Window = ReorderWindow<DecodeBuffer, std::array<WindowGroup<std::array<bool, parity_size+2>>, reorder_groups>,
+                                     std::array<uint8_t, multi_ceil(sizeof(T), padded_size(parity_size))>,
+                                     parity_size*(reorder_groups+1)>;
+        friend Window;
+        using typename Window::Group;
+        using typename Window::Output;
+        using Window::m_window;
+        using Window::m_delivery;
+        using Window::m_outBuf;
+        using Window::m_outDropped;
+        using Window::m_stats;
+    public:
+        using Clock = std::chrono::steady_clock;
+    private:
+        static constexpr int padded = padded_size(parity_size);        // columns of the geometry (see EncodeBuffer)
+        static constexpr size_t bytes = multi_ceil(sizeof(T), padded);
+        using Block = std::array<uint8_t, bytes/padded>;
+        using Matrix = GroupMatrix<parity_size+2, bytes>;               // the columns sent (data, P, Q)
+        // times of a group (the window has the rest of its metadata)
+        struct Timing{
+            Clock::time_point deadline;
+        #if RPPP_STATS
+            Clock::time_point first;                    // arrival of the first packet
+            std::array<Clock::time_point, parity_size> arrival;
+        #endif
+        };
+        static constexpr RecoverySchedule<padded> s_schedule {};
+        std::array<Matrix, reorder_groups> m_arena;     // packets of m_window[i], reused by the next groups
+        std::array<Timing, reorder_groups> m_timing;    // of m_window[i]
+        Clock::duration m_deadline;                     // 0: no deadline
+        ColumnSplitter m_splitter;
+    #if RPPP_STATS
+        Clock::time_point m_now;                        // time of the current enq() / poll()
+    #endif
+
+    public:
+        DecodeBuffer() :
+            m_arena{},
+            m_timing{},
+            m_deadline(0)
+        {}
+
+        void set_delivery(Delivery delivery){
+            m_delivery = delivery;
+        }
+
+        // give up a group when the time has passed from its first packet. (0: never)
+        void set_deadline(Clock::duration deadline){
+            m_deadline = deadline;
+        }
+
+        // recover the lost data of large items in tasks
+        void set_splitter(const ColumnSplitter& splitter){
+            m_splitter = splitter;
+        }
+
+        Status enq(const StreamData<T, parity_size, H> &sd){
+            return enq(sd, (m_deadline.count() || RPPP_STATS) ? Clock::now() : Clock::time_point());
+        }
+
+        Status enq(const StreamData<T, parity_size, H> &sd, Clock::time_point now){
+            const size_t dropped = m_outDropped;
+            const int pos = sd.header.template position<parity_size>();
+            if (pos < 0 || pos >= parity_size+2)
+                return Status::INVALID_ARGUMENT;
+        #if RPPP_STATS
+            m_now = now;
+        #endif
+
+            expire(now);
+            const int64_t number = this->admit(sd.header.epoch, sd.header.template group<parity_size>(),
+                                               [&](int64_t base){ return sd.header.template distance<parity_size>(base); });
+            if (number < 0)
+                return Status::OK;
+
+            Group& g = this->group_of(number);
+            if (not g.used)
+                open(g, number, now);
+            if (g.received[pos] || (g.decoded && pos < parity_size) || g.output_cnt == parity_size){ // duplicated
+                m_stats.duplicates.add();
+                return Status::OK;
             }
-            else if (m_inBuf.size() == parity_size)
+
+            memcpy(column(g, pos), sd.data, bytes);
+            g.received[pos] = true;
+            g.received_cnt++;
+            m_stats.packets.add();
+        #if RPPP_STATS
+            if (pos < parity_size)
+                timing(g).arrival[pos] = now;
+        #endif
+            if (m_delivery == Delivery::EARLY && pos < parity_size)
+                this->output(g, pos, false);
+            if (not g.decoded && g.received_cnt >= parity_size)
             {
-                decode();
-                next_period();
+                decode(g);
+                if (m_delivery == Delivery::EARLY){
+                    for (int i=0; i<parity_size; i++){
+                        if (not g.output[i])
+                            this->output(g, i, true);
+                    }
+                }
             }
-            m_prevSeqId = stream.first.seq_id;
+            this->deliver();
+
+            // the output was full and some items were discarded
+            if (m_outDropped != dropped)
+                return Status::BUFFER_FULL;
+            return Status::OK;
+        }
 
+        // give up the groups whose deadline has passed (without waiting for the next packet)
+        Status poll(Clock::time_point now = Clock::now()){
+            const size_t dropped = m_outDropped;
+        #if RPPP_STATS
+            m_now = now;
+        #endif
+            expire(now);
+            if (m_outDropped != dropped)
+                return Status::BUFFER_FULL;
             return Status::OK;
         }
 
+        // enqueue packets while the output has room for the whole window. returns the number of enqueued packets.
+        size_t enq_batch(span<const StreamData<T, parity_size, H>> packets){
+            size_t i = 0;
+            for (; i<packets.size() && m_outBuf.free() >= parity_size*reorder_groups; i++)
+                enq(packets[i]);
+            return i;
+        }
+
+        // dequeue items into a contiguous array (given up items are skipped). returns the number of items.
+        size_t drain(span<T> out){
+            size_t i = 0;
+            while (i < out.size() && this->skip_gaps())
+            {
+                memcpy(&out[i++], m_outBuf.front().item.data(), sizeof(T));
+                m_outBuf.pop();
+            }
+            return i;
+        }
+
+        // given up items are skipped
         Status deq(T *p){
-            if(m_outBuf.size() == 0)
+            if(not this->skip_gaps())
                 return Status::NO_ELEMENT;
             
-            memcpy(p, m_outBuf.front().data(), sizeof(T));
+            memcpy(p, m_outBuf.front().item.data(), sizeof(T));
             m_outBuf.pop();
             
             return Status::OK;
         }
 
-        void reset(){
-            m_inBuf.clear();
-            std::queue<Blocks> empty;
-            std::swap(empty, m_outBuf);
-            m_expectSeqId = 0;
-            m_nextSeqIdFloor = parity_size+2;
-            m_prevSeqId = 0;
-            m_lossCnt = 0;
-            m_flag_first_call = true;
+        // Status::LOST: items [info->index, info->index + info->lost) are given up. (*p is not written)
+        Status deq(T *p, ItemInfo *info){
+            const Status status = this->front(info);
+            if (status != Status::OK)
+                return status;
+            memcpy(p, m_outBuf.front().item.data(), sizeof(T));
+            m_outBuf.pop();
+
+            return Status::OK;
         }
 
-        size_t count(){
-            return m_outBuf.size();
+        // counters and histograms (zero without RPPP_STATS). safe to call from another thread.
+        stats::DecodeStats::Snapshot stats() const{
+            return m_stats.snapshot();
         }
     
     private:
-        inline void next_period(){
-            m_inBuf.clear();
-            m_lossCnt=0;
-            m_expectSeqId = m_nextSeqIdFloor;
-            m_nextSeqIdFloor = multi_ceil(m_expectSeqId+1, parity_size+2);
+        static constexpr int group_items(){
+            return parity_size;
         }
 
-        inline void decode(){
-            if (m_lossCnt == 0)
-            {
+        // item pos of the group (see ReorderWindow)
+        inline void write(std::array<uint8_t, bytes>& item, const Group& g, int pos, bool recovered){
+            memcpy(item.data(), column(g, pos), bytes);
+        #if RPPP_STATS
+            m_stats.latency.record(m_now - (recovered ? timing(g).first : timing(g).arrival[pos]));
+        #else
+            (void)recovered;
+        #endif
+        }
+
+        inline void open(Group& g, int64_t number, Clock::time_point now){
+            Window::open(g, number);
+            timing(g).deadline = now + m_deadline;
+        #if RPPP_STATS
+            timing(g).first = now;
+        #endif
+        }
+
+        // give up the groups whose deadline has passed, and all groups before them
+        inline void expire(Clock::time_point now){
+            if (m_deadline.count() == 0)
                 return;
+            int64_t last = this->m_base - 1;
+            for (auto& g : m_window){
+                if (g.used && timing(g).deadline <= now)
+                    last = std::max(last, g.number);
+            }
+            if (last >= this->m_base)
+                this->flush(last + 1);
+        }
+
+        // restore the lost data from parity_size received packets
+        inline void decode(Group& g){
+            // lost columns of data and P (parity_size received, so at most 2)
+            std::array<int, 2> lost;
+            int lost_num = 0;
+            for (int c=0; c<parity_size+1 && lost_num<2; c++){
+                if (not g.received[c])
+                    lost[lost_num++] = c;
             }
-            else if (m_lossCnt == 1) // calculate from Horizaonal parity
+
+            if (lost_num == 0 || lost[0] == parity_size)
             {
-                int i;
-                for (i=0; i<parity_size; i++) 
-                {
-                    if(m_inBuf[i].first.seq_id%(parity_size+2) != i)
-                    {
-                        Blocks restore_data {};
-                        for (int j=0; j<parity_size; j++)
-                        {
-                            for (int k=0; k<parity_size; k++)
-                            {
-                                restore_data[j] = block_xor(restore_data[j], m_inBuf[k].second[j]);
-                            }
-                        }
-                        m_outBuf.push(restore_data);
-                        break;
-                    }
-                }
-                for (;i<parity_size-1; i++)
-                { // last of m_inBuf is Horizonal Parity Blocks
-                    m_outBuf.push(m_inBuf[i].second);
-                }
+                m_stats.groups_clean.add(); // all data received
             }
-            else // m_lossCnt == 2, calculate from Diagonal & Hrizonal Parity
+            else if (m_splitter.splits(sizeof(Block)))
             {
-                std::vector<Blocks> all_data;
-                std::vector<int> drop_numbers;
-
-                // init all_data and drop_number
-                int k = 0;
-                for (int i=0; i<parity_size; i++)
-                {
-                    while(m_inBuf[i].first.seq_id%(parity_size+2) != k){
-                        Blocks b {};
-                        all_data.push_back(b);
-                        drop_numbers.push_back(k);
-                        k++;
-                    }
-                    all_data.push_back(m_inBuf[i].second);
-                    k++;
+                stats::Timer timer(m_stats.decode_time);
+                (lost_num == 1 ? m_stats.groups_p : m_stats.groups_pq).add();
+                struct Task{
+                    pq::Columns cols;
+                    int a;
+                    int b;          // -1: a single loss
+                    int m;
+                } task {columns_of(g), geometry(lost[0]), -1, 0};
+                if (lost_num == 2){
+                    task.b = geometry(lost[1]);
+                    task.m = s_schedule.mid(task.a, task.b);
                 }
-
-                // scanning blocks what can be decoded from Diagonal Parity
-                std::array<int, parity_size+1> q_count {};
-                for(auto i : drop_numbers)
-                {
-                    for(int j=0; j<parity_size; j++)
-                    {
-                        if(q_number(i,j) != parity_size)
-                            q_count[q_number(i,j)] += 1;
-                        else
-                            q_count[q_number(i,j)] = 0;
+                m_splitter.run(m_splitter.ctx, sizeof(Block), [](void *arg, size_t begin, size_t end){
+                    const Task& t = *static_cast<Task*>(arg);
+                    if (t.b < 0){
+                        for (int r=0; r<padded; r++)
+                            pq::recover_from_row<parity_size>(t.cols, t.a, r, begin, end);
                     }
-                }
-
-                // decode blocks what can be decoded from Diagonal Parity (q_count[q_number(i,j)] == 1)
-                int decode_count = 0;
-                std::vector<int> calculatable_row;
-                for(int i=0; i<parity_size; i++)
-                    calculatable_row.push_back(i);
-                while (decode_count < parity_size*2){
-                    for(auto i : drop_numbers)
-                    {
-                        for(int j : calculatable_row)
-                        {
-                            if(q_count[q_number(i,j)] == 1) // It is can be decoded from Diagonal Parity
-                            {
-                                // decode
-                                Block block {};
-                                for(int k=0; k<parity_size+1; k++)
-                                {
-                                    if((j+k)%(parity_size+1) != parity_size)
-                                        block = block_xor(block, all_data[(i+k)%(parity_size+1)][(j+k)%(parity_size+1)]);
-                                }
-                                block = block_xor(block, all_data[parity_size+1][q_number(i,j)]); // xor Diagonal parity
-
-                                q_count[q_number(i,j)] -= 1; // set a next decodable block
-                                all_data[i][j] = block;
-                                decode_count++;
-
-                                // decode neighboor block
-                                Block neighboor_block {};
-                                int max = *std::max_element(drop_numbers.begin(), drop_numbers.end());
-                                int min = *std::min_element(drop_numbers.begin(), drop_numbers.end());
-                                int neighboor_i = (i==max)?min:max;
-
-                                for(int k=0; k<parity_size+1; k++)
-                                {
-                                    neighboor_block = block_xor(neighboor_block, all_data[k][j]);
-                                }
-
-                                q_count[q_number(neighboor_i,j)] -= 1; // set a next decodable block
-                                all_data[neighboor_i][j] = neighboor_block;
-                                decode_count++;
-
-                                calculatable_row.erase(
-                                    std::remove(calculatable_row.begin(), calculatable_row.end(), j), calculatable_row.end()
-                                );
-                            }
-                        }
-                    }
-                }
-                // output remain data
-                for(int i=*std::min_element(drop_numbers.begin(), drop_numbers.end()); i<parity_size; i++)
-                {
-                    m_outBuf.push(all_data[i]);
-                }
+                    else
+                        pq::recover_pair<parity_size>(t.cols, t.a, t.b, t.m, begin, end);
+                }, &task);
             }
+            else if (lost_num == 1)
+            {
+                // calculate from Horizonal parity
+                stats::Timer timer(m_stats.decode_time);
+                pq::recover_column<parity_size>(columns_of(g), lost[0]);
+                m_stats.groups_p.add();
+            }
+            else if (lost_num == 2)
+            {
+                // calculate from Diagonal & Horizonal parity
+                stats::Timer timer(m_stats.decode_time);
+                m_stats.groups_pq.add();
+                const int a = geometry(lost[0]), b = geometry(lost[1]);
+                pq::recover_pair<parity_size>(columns_of(g), a, b, s_schedule.mid(a, b), 0, sizeof(Block));
+            }
+            g.decoded = true;
         }
 
-        inline Block block_xor(const Block& lhs, const Block& rhs){
-            Block ret;
-            for(int i=0; i<static_cast<int>(ret.size()); i++)
-                ret[i] = lhs[i] xor rhs[i];
-            return ret;
+        // column c (data, P, Q) of the group
+        inline uint8_t* column(const Group& g, int c){
+            return m_arena[&g - m_window.data()].column(c);
+        }
+        inline Timing& timing(const Group& g){
+            return m_timing[&g - m_window.data()];
+        }
+        // the stored columns in the geometry (see pq). the packet positions are
+        // data 0..parity_size-1, P parity_size and Q parity_size+1, and P is the
+        // column `padded` of the geometry (geometry())
+        inline pq::Columns columns_of(const Group& g){
+            return {column(g, 0), Matrix::stride, column(g, parity_size), column(g, parity_size+1), sizeof(Block), padded, parity_size};
         }
 
-        inline int q_number(int i, int j){
-            // Diagonal parity block position where block_i_j is calculated
-            return ((i-j)+parity_size+1)%(parity_size+1);
+        // column of position c in the geometry
+        static constexpr int geometry(int c){
+            return (c == parity_size) ? padded : c;
         }
     };
 }
\ No newline at end of file
@@ -0,0 +1,412 @@
+#pragma once
+#include "RPPP.hpp"
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <bitset>
+
+namespace rppp{
+
+    /*
+    adaptive parity size
+
+    the encoder has an EncodeBuffer for each of the precompiled sizes (ascending),
+    and switches between them at group boundaries:
+
+        receiver : decoder.report()   -> LossReport -> (your channel back)
+        sender   : encoder.on_report(report)
+
+    every switch starts a new segment. the packets carry the segment in
+    Header::epoch and the index of the size (level) in Header::lane, and only
+    AdaptiveData::size() bytes have to be sent.
+
+    the level is the largest size whose group loss probability (3 or more of
+    parity_size+2 packets) at the smoothed packet loss rate is within the target.
+    it goes down at once and up after `up_reports` reports in a row.
+    */
+    template<class T, int... sizes>
+    struct AdaptiveData{
+        static constexpr std::array<size_t, sizeof...(sizes)> bytes {multi_ceil(sizeof(T), padded_size(sizes))...};
+        Header header;      // epoch: segment, lane: level
+        uint8_t data[std::max({multi_ceil(sizeof(T), padded_size(sizes))...})];
+
+        // bytes to send
+        size_t size() const{
+            return sizeof(Header) + (header.lane < bytes.size() ? bytes[header.lane] : 0);
+        }
+    };
+
+    // packets of the receiver since the last report
+    struct LossReport{
+        uint32_t received;
+        uint32_t lost;
+    };
+
+    // probability that a group of parity_size+2 packets loses 3 or more (unrecoverable)
+    inline double group_loss_probability(int parity_size, double loss){
+        const int packets = parity_size+2;
+        double ok = 0, c = 1; // c = C(packets, k)
+        for (int k=0; k<=2; k++){
+            ok += c * std::pow(loss, k) * std::pow(1-loss, packets-k);
+            c = c * (packets-k) / (k+1);
+        }
+        return std::max(0.0, 1-ok);
+    }
+
+    namespace adaptive{
+        // f(std::integral_constant<size_t, level>) for the runtime level
+        template<class F, size_t... I>
+        inline void visit(int level, F&& f, std::index_sequence<I...>){
+            ((level == static_cast<int>(I) ? f(std::integral_constant<size_t, I>{}) : void()), ...);
+        }
+
+        template<int... sizes>
+        constexpr bool ascending(){
+            constexpr int s[] = {sizes...};
+            for (size_t i=1; i<sizeof...(sizes); i++){
+                if (s[i-1] >= s[i])
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    template<class T, int... sizes>
+    class AdaptiveEncoder{
+        static_assert(sizeof...(sizes) >= 1, "at least one parity size.");
+        static_assert(sizeof...(sizes) <= std::numeric_limits<uint8_t>::max()+1, "too many parity sizes.");
+        static_assert(adaptive::ascending<sizes...>(), "parity sizes must be ascending.");
+        static constexpr int levels = sizeof...(sizes);
+        static constexpr std::array<int, levels> s_sizes {sizes...};
+        using Levels = std::make_index_sequence<levels>;
+        std::tuple<EncodeBuffer<T, sizes>...> m_buffers;
+        int m_level;
+        int m_target;           // level after the current group
+        int m_count;            // items of the current group
+        uint8_t m_segment;
+        double m_loss;          // smoothed packet loss rate (< 0: no report yet)
+        double m_targetLoss;
+        int m_up;               // reports in a row which want a larger size
+        int m_upReports;
+
+    public:
+        // starts at the smallest size (the most robust)
+        AdaptiveEncoder() :
+            m_level(0), m_target(0), m_count(0), m_segment(0),
+            m_loss(-1), m_targetLoss(1e-3), m_up(0), m_upReports(3)
+        {}
+
+        Status enq(const T &item){
+            if (m_count == 0 && m_target != m_level && count() == 0){ // group boundary
+                m_level = m_target;
+                m_segment++;
+                visit([&](auto& buf){ buf.reset(); });
+            }
+            Status status = Status::OK;
+            visit([&](auto& buf){ status = buf.enq(item); });
+            if (status != Status::BUFFER_FULL)
+                m_count = (m_count+1) % s_sizes[m_level];
+            return status;
+        }
+
+        Status deq(AdaptiveData<T, sizes...> *p){
+            Status status = Status::NO_ELEMENT;
+            adaptive::visit(m_level, [&](auto level){
+                auto& buf = std::get<level>(m_buffers);
+                auto* sd = buf.peek();
+                if (sd == nullptr)
+                    return;
+                p->header = sd->header;
+                p->header.epoch = m_segment;
+                p->header.lane = static_cast<uint8_t>(level);
+                memcpy(p->data, sd->data, sizeof(sd->data));
+                status = buf.pop();
+            }, Levels{});
+            return status;
+        }
+
+        // adapt the level to the receiver's loss
+        void on_report(const LossReport& report){
+            const uint64_t total = static_cast<uint64_t>(report.received) + report.lost;
+            if (total == 0)
+                return;
+            const double loss = static_cast<double>(report.lost) / total;
+            m_loss = (m_loss < 0) ? loss : m_loss + 0.25*(loss - m_loss);
+
+            const int want = level_for(m_loss);
+            if (want <= m_level){
+                m_target = want;
+                m_up = 0;
+            }
+            else if (++m_up >= m_upReports){
+                m_target = want;
+                m_up = 0;
+            }
+        }
+
+        // the largest acceptable probability of an unrecoverable group (default 0.1%)
+        void set_target_loss(double target){
+            m_targetLoss = target;
+        }
+        // reports in a row needed to use a larger size (default 3)
+        void set_up_reports(int reports){
+            m_upReports = std::max(1, reports);
+        }
+        // switch to the level at the next group boundary
+        void set_level(int level){
+            m_target = std::min(std::max(level, 0), levels-1);
+            m_up = 0;
+        }
+
+        int level() const{
+            return m_level;
+        }
+        int parity_size() const{
+            return s_sizes[m_level];
+        }
+        double loss() const{
+            return std::max(0.0, m_loss);
+        }
+
+        // the largest size for the packet loss rate
+        int level_for(double loss) const{
+            int level = 0;
+            for (int i=1; i<levels; i++){
+                if (group_loss_probability(s_sizes[i], loss) <= m_targetLoss)
+                    level = i;
+            }
+            return level;
+        }
+
+        void reset(){
+            visit([&](auto& buf){ buf.reset(); });
+            m_count = 0;
+            m_segment++;
+        }
+
+        size_t count(){
+            size_t n = 0;
+            visit([&](auto& buf){ n = buf.count(); });
+            return n;
+        }
+
+    private:
+        template<class F>
+        inline void visit(F&& f){
+            adaptive::visit(m_level, [&](auto level){ f(std::get<level>(m_buffers)); }, Levels{});
+        }
+    };
+
+    /*
+    decoder of AdaptiveEncoder.
+    each segment goes to the DecodeBuffer of its level, which is reset when the
+    segment starts (a level may be unused for any number of segments, so its
+    epoch can't tell an old segment from a new one). the items of the next
+    segment are held until the current segment is finished: when it has no group
+    in flight, or the next segment has got reorder_groups groups of packets.
+    */
+    template<class T, int... sizes>
+    class AdaptiveDecoder{
+        static constexpr int levels = sizeof...(sizes);
+        static constexpr std::array<int, levels> s_sizes {sizes...};
+        static constexpr int reorder_groups = 2;
+        using Levels = std::make_index_sequence<levels>;
+        static constexpr int64_t s_window = (int64_t(std::numeric_limits<seq_id_t>::max()) + 1)/2; // >= seq_id_wrap()/2
+        struct Segment{
+            int level;
+            uint8_t id;
+            int64_t packets;    // not duplicated
+            int64_t highest;    // unwrapped seq_id (-1: none)
+            std::bitset<s_window> seen; // received seq_ids in (highest - wrap/2, highest], by unwrapped seq_id % s_window
+        };
+        std::tuple<DecodeBuffer<T, sizes, reorder_groups>...> m_buffers;
+        Segment m_cur;
+        Segment m_next;
+        bool m_started;
+        bool m_hasNext;
+        bool m_curFinished;
+        int m_drain;            // level of a finished segment whose items are output first (-1: none)
+        uint64_t m_expected;    // packets sent (up to the highest seq_id of each segment)
+        uint64_t m_received;
+        uint64_t m_reportedExpected;
+        uint64_t m_reportedReceived;
+
+    public:
+        AdaptiveDecoder() :
+            m_cur{}, m_next{}, m_started(false), m_hasNext(false), m_curFinished(false), m_drain(-1),
+            m_expected(0), m_received(0), m_reportedExpected(0), m_reportedReceived(0)
+        {}
+
+        Status enq(const AdaptiveData<T, sizes...> &ad){
+            const int level = ad.header.lane;
+            if (level >= levels)
+                return Status::INVALID_ARGUMENT;
+            const uint8_t id = ad.header.epoch;
+
+            if (not m_started){
+                m_cur = {level, id, 0, -1};
+                m_started = true;
+                open(level);
+            }
+            if (static_cast<int8_t>(id - m_cur.id) < 0)
+                return Status::OK; // a finished segment
+            if (id != m_cur.id && m_hasNext && id != m_next.id){
+                // a segment after the next: the current one is over
+                // (its items which are not dequeued yet come out before the next segment's)
+                advance();
+            }
+            if (id != m_cur.id && not m_hasNext){
+                if (level == m_cur.level){
+                    // the same level (the encoder's reset): the DecodeBuffer restarts by the epoch
+                    m_cur = {level, id, 0, -1};
+                }
+                else{
+                    m_next = {level, id, 0, -1};
+                    m_hasNext = true;
+                    open(level);
+                }
+            }
+
+            Segment& seg = (id == m_cur.id) ? m_cur : m_next;
+            if (seg.level != level)
+                return Status::INVALID_ARGUMENT;
+            count_packet(seg, ad.header.seq_id);
+
+            // the segment is the epoch of the level's DecodeBuffer
+            Status status = Status::OK;
+            adaptive::visit(level, [&](auto l){
+                constexpr int n = s_sizes[l];
+                StreamData<T, n> sd;
+                sd.header = ad.header;
+                memcpy(sd.data, ad.data, sizeof(sd.data));
+                status = std::get<l>(m_buffers).enq(sd);
+            }, Levels{});
+
+            if (m_hasNext && not m_curFinished &&
+                (idle(m_cur.level) || m_next.packets >= reorder_groups*(s_sizes[m_next.level]+2))){
+                finish(m_cur.level);
+                m_curFinished = true;
+            }
+            return status;
+        }
+
+        // given up items are skipped
+        Status deq(T *p){
+            for (;;){
+                Status status = Status::NO_ELEMENT;
+                const int level = (m_drain >= 0) ? m_drain : m_cur.level;
+                adaptive::visit(level, [&](auto l){ status = std::get<l>(m_buffers).deq(p); }, Levels{});
+                if (status == Status::OK)
+                    return status;
+                if (m_drain >= 0){
+                    m_drain = -1;
+                    continue;
+                }
+                if (not (m_hasNext && m_curFinished))
+                    return status;
+                advance();
+            }
+        }
+
+        // the loss since the last report (send it to AdaptiveEncoder::on_report())
+        LossReport report(){
+            const uint64_t expected = m_expected - m_reportedExpected;
+            const uint64_t received = m_received - m_reportedReceived;
+            m_reportedExpected = m_expected;
+            m_reportedReceived = m_received;
+            return {static_cast<uint32_t>(received), static_cast<uint32_t>(expected > received ? expected - received : 0)};
+        }
+
+        int level() const{
+            return m_cur.level;
+        }
+
+        void reset(){
+            for (int l=0; l<levels; l++)
+                adaptive::visit(l, [&](auto i){ std::get<i>(m_buffers).reset(); }, Levels{});
+            m_started = false;
+            m_hasNext = false;
+            m_curFinished = false;
+            m_drain = -1;
+        }
+
+        // items ready in the current segment (and the rest of a finished one)
+        size_t count(){
+            size_t n = count_of(m_cur.level);
+            if (m_drain >= 0)
+                n += count_of(m_drain);
+            return n;
+        }
+
+    private:
+        // the next segment becomes the current one (the groups in flight of the current one
+        // are given up, and its items ready are output before the next segment's)
+        inline void advance(){
+            if (not m_hasNext)
+                return;
+            finish(m_cur.level);
+            if (count_of(m_cur.level))
+                m_drain = m_cur.level;
+            m_cur = m_next;
+            m_hasNext = false;
+            m_curFinished = false;
+        }
+
+        // count a packet for report(), once per seq_id (the channel may duplicate packets)
+        inline void count_packet(Segment& seg, seq_id_t seq_id){
+            const int64_t wrap = seq_id_wrap(s_sizes[seg.level]);
+            int64_t number;
+            if (seg.highest < 0){
+                number = seq_id;
+                seg.highest = number;
+                m_expected += seq_id + 1;
+            }
+            else{
+                const int64_t diff = (seq_id - seg.highest%wrap + wrap)%wrap;
+                if (diff > 0 && diff < wrap/2){
+                    // the seq_ids skipped by the jump are not received yet
+                    for (int64_t i=1; i<=std::min(diff, s_window); i++)
+                        seg.seen.reset((seg.highest + i)%s_window);
+                    seg.highest += diff;
+                    m_expected += diff;
+                    number = seg.highest;
+                }
+                else{
+                    const int64_t back = (wrap - diff)%wrap;
+                    number = seg.highest - back;
+                    if (back >= wrap/2 || number < 0)
+                        return; // too old to tell
+                }
+            }
+            if (seg.seen.test(number%s_window))
+                return;
+            seg.seen.set(number%s_window);
+            seg.packets++;
+            m_received++;
+        }
+
+        // a new segment of the level: the DecodeBuffer restarts at its epoch
+        // (the rest of a finished segment of the level is given up)
+        inline void open(int level){
+            if (level == m_drain)
+                m_drain = -1;
+            adaptive::visit(level, [&](auto l){ std::get<l>(m_buffers).reset(); }, Levels{});
+        }
+
+        inline size_t count_of(int level){
+            size_t n = 0;
+            adaptive::visit(level, [&](auto l){ n = std::get<l>(m_buffers).count(); }, Levels{});
+            return n;
+        }
+
+        inline bool idle(int level){
+            bool ret = false;
+            adaptive::visit(level, [&](auto l){ ret = std::get<l>(m_buffers).in_flight() == 0; }, Levels{});
+            return ret;
+        }
+
+        inline void finish(int level){
+            adaptive::visit(level, [&](auto l){ std::get<l>(m_buffers).finish(); }, Levels{});
+        }
+    };
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include "RPPP.hpp"
+
+namespace rppp{
+
+    /*
+    coalescing of small items
+
+    CoalesceEncoder packs up to K consecutive items into a Batch<T, K>, which is
+    one item (a packet) of the parity group of EncodeBuffer. a batch is sent when
+    it has K items, or when its first item is older than the timeout
+    (set_timeout(), checked by enq() and poll()), or by flush().
+    CoalesceDecoder recovers the batches with DecodeBuffer and unpacks them.
+
+        parity_size = 4, K = 3
+        item   : 0 1 2  3 4 5  6 7 8  9 10 11
+        packet : [0 1 2] [3 4 5] [6 7 8] [9 10 11] P Q
+
+    the packet rate falls K-fold, and 2 lost packets (2K items) of a group are
+    recovered. the unused items of a partial batch are zero, so wire_size()
+    cuts them.
+    */
+    template<class T, int K>
+    struct Batch{
+        uint16_t count;     // items in `items`
+        T items[K];
+    };
+
+    template<class T, int K, int parity_size, class H = Header>
+    class CoalesceEncoder{
+        static_assert(K >= 1 && K <= std::numeric_limits<uint16_t>::max(), "K must be in [1, 65535].");
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        EncodeBuffer<Batch<T, K>, parity_size, H> m_encoder;
+        Batch<T, K> m_batch;
+        Clock::time_point m_first;  // arrival of the first item of m_batch
+        Clock::duration m_timeout;  // 0: full batches (and flush()) only
+
+    public:
+        CoalesceEncoder() : m_timeout(0){
+            memset(&m_batch, 0, sizeof(m_batch));
+        }
+
+        // send a partial batch when its first item is older than `timeout`. (0: never)
+        void set_timeout(Clock::duration timeout){
+            m_timeout = timeout;
+        }
+
+        // Status::OK_PARITY_GENERATED: the batch completed a parity group.
+        // Status::BUFFER_FULL: the item is not enqueued (deq() the packets first)
+        Status enq(const T &item){
+            return enq(item, m_timeout.count() ? Clock::now() : Clock::time_point());
+        }
+
+        Status enq(const T &item, Clock::time_point now){
+            if (m_batch.count >= K) // a full batch is always sent, or its last item is taken back
+                return Status::BUFFER_FULL;
+            if (m_batch.count == 0)
+                m_first = now;
+            m_batch.items[m_batch.count++] = item;
+            if (m_batch.count < K && not expired(now))
+                return Status::OK;
+            const Status status = send();
+            if (status == Status::BUFFER_FULL)
+                memset(&m_batch.items[--m_batch.count], 0, sizeof(T));
+            return status;
+        }
+
+        // send the partial batch if it is older than the timeout.
+        // Status::NO_ELEMENT: nothing to send
+        Status poll(Clock::time_point now = Clock::now()){
+            if (m_batch.count == 0 || not expired(now))
+                return Status::NO_ELEMENT;
+            return send();
+        }
+
+        // send the partial batch now
+        Status flush(){
+            if (m_batch.count == 0)
+                return Status::NO_ELEMENT;
+            return send();
+        }
+
+        Status deq(StreamData<Batch<T, K>, parity_size, H>* psd){
+            return m_encoder.deq(psd);
+        }
+
+        // front of the output without copy. (nullptr if empty)
+        const StreamData<Batch<T, K>, parity_size, H>* peek() const{
+            return m_encoder.peek();
+        }
+
+        Status pop(){
+            return m_encoder.pop();
+        }
+
+        void reset(){
+            m_encoder.reset();
+            memset(&m_batch, 0, sizeof(m_batch));
+        }
+
+        // packets ready to send
+        size_t count(){
+            return m_encoder.count();
+        }
+
+        // items waiting for the batch
+        size_t pending() const{
+            return m_batch.count;
+        }
+
+    private:
+        inline bool expired(Clock::time_point now) const{
+            return m_timeout.count() && now - m_first >= m_timeout;
+        }
+
+        inline Status send(){
+            const Status status = m_encoder.enq(m_batch);
+            if (status == Status::BUFFER_FULL)
+                return status;
+            memset(&m_batch, 0, sizeof(m_batch));
+            return status;
+        }
+    };
+
+    /*
+    decoder of CoalesceEncoder.
+    ItemInfo of deq() is about the batches: index is the batch number, lost is the
+    number of given up batches (their items are unknown), and recovered is set on
+    every item of a recovered batch.
+    */
+    template<class T, int K, int parity_size, int reorder_groups = 2, class H = Header>
+    class CoalesceDecoder{
+        using Decoder = DecodeBuffer<Batch<T, K>, parity_size, reorder_groups, H>;
+        Decoder m_decoder;
+        Batch<T, K> m_batch;        // being unpacked
+        ItemInfo m_info;            // of m_batch
+        int m_next;                 // next item of m_batch
+
+    public:
+        using Clock = typename Decoder::Clock;
+
+        CoalesceDecoder() : m_info{}, m_next(0){
+            m_batch.count = 0;
+        }
+
+        void set_deadline(typename Clock::duration deadline){
+            m_decoder.set_deadline(deadline);
+        }
+
+        Status enq(const StreamData<Batch<T, K>, parity_size, H> &sd){
+            return m_decoder.enq(sd);
+        }
+
+        Status enq(const StreamData<Batch<T, K>, parity_size, H> &sd, typename Clock::time_point now){
+            return m_decoder.enq(sd, now);
+        }
+
+        Status poll(typename Clock::time_point now = Clock::now()){
+            return m_decoder.poll(now);
+        }
+
+        // given up batches are skipped
+        Status deq(T *p){
+            ItemInfo info;
+            Status status;
+            while ((status = deq(p, &info)) == Status::LOST){}
+            return status;
+        }
+
+        // Status::LOST: batches [info->index, info->index + info->lost) are given up. (*p is not written)
+        // Status::INVALID_ARGUMENT: a batch of more than K items is skipped
+        Status deq(T *p, ItemInfo *info){
+            if (m_next >= m_batch.count){
+                const Status status = m_decoder.deq(&m_batch, &m_info);
+                if (status != Status::OK){
+                    if (status == Status::LOST)
+                        *info = m_info;
+                    m_batch.count = 0;
+                    return status;
+                }
+                m_next = 0;
+                if (m_batch.count > K){
+                    m_batch.count = 0;
+                    return Status::INVALID_ARGUMENT;
+                }
+                if (m_batch.count == 0)
+                    return deq(p, info);
+            }
+            *p = m_batch.items[m_next++];
+            *info = m_info;
+            return Status::OK;
+        }
+
+        void reset(){
+            m_decoder.reset();
+            m_batch.count = 0;
+            m_next = 0;
+        }
+
+        void finish(){
+            m_decoder.finish();
+        }
+    };
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include "RPPP.hpp"
+#include <cstddef>
+
+namespace rppp{
+
+    /*
+    delta compression in front of the encoder (state snapshots)
+
+    DeltaEncoder XORs an item against a baseline which the receiver has, and
+    zero run length encodes the result into a Delta<T>, which is the item type
+    of EncodeBuffer / DecodeBuffer. DeltaDecoder reverses it after
+    DecodeBuffer::deq(). the baseline is
+        PREVIOUS : the previous item, and a keyframe (no baseline) every
+                   keyframe_interval items to resync after an unrecoverable loss
+        ACKED    : the newest item acknowledged by the receiver (ack()), or a
+                   keyframe when there is none in the history
+
+    a Delta<T> is zero padded, so wire_size() cuts the trailing zeros of a
+    packet before sending, and from_wire() pads them back. (P parity is as short
+    as the longest item of the group. Q parity mixes all blocks of the items and
+    is about as long as the items of the group together)
+    */
+    enum DeltaMode{
+        PREVIOUS,
+        ACKED,
+    };
+
+    template<class T>
+    struct Delta{
+        // a token is (zero bytes, literal bytes, literals...). (0, 0) or the end: the rest is unchanged
+        static constexpr size_t max_bytes = sizeof(T) + 2*((sizeof(T) + 254)/255) + 2;
+        uint32_t seq;           // item number
+        uint16_t distance;      // baseline = seq - distance (0: keyframe)
+        uint8_t epoch;          // DeltaEncoder::reset() count (the decoder drops the old history)
+        uint8_t bytes[max_bytes];
+    };
+
+    namespace delta{
+        inline uint64_t load_word(const uint8_t *p){
+            uint64_t w;
+            memcpy(&w, p, sizeof(w));
+            return w;
+        }
+
+        // zero run length encoding of x. returns the number of bytes (without the end token)
+        inline size_t encode_zrle(const uint8_t *x, size_t size, uint8_t *out){
+            const size_t last = trim_zeros(x, size); // one past the last non zero byte
+            size_t n = 0;
+            for (size_t i=0; i<last;){
+                size_t zeros = 0;
+                while (i+8 <= last && zeros <= 255-8 && load_word(x + i) == 0){
+                    zeros += 8;
+                    i += 8;
+                }
+                while (i < last && x[i] == 0 && zeros < 255){
+                    zeros++;
+                    i++;
+                }
+                // a literal ends at two zeros (a single zero is cheaper in the literal)
+                size_t start = i;
+                while (i < last && i-start < 255 && not (x[i] == 0 && (i+1 == last || x[i+1] == 0)))
+                    i++;
+                out[n++] = static_cast<uint8_t>(zeros);
+                out[n++] = static_cast<uint8_t>(i-start);
+                memcpy(out + n, x + start, i-start);
+                n += i-start;
+            }
+            return n;
+        }
+
+        // out ^= decoded bytes. false if the tokens run out of the item
+        inline bool apply_zrle(const uint8_t *in, size_t in_size, uint8_t *out, size_t size){
+            size_t pos = 0;
+            for (size_t n=0; n+2 <= in_size;){
+                const size_t zeros = in[n];
+                const size_t literals = in[n+1];
+                n += 2;
+                if (zeros == 0 && literals == 0)
+                    break;
+                if (pos + zeros + literals > size || n + literals > in_size)
+                    return false;
+                pos += zeros;
+                simd::xor_into(out + pos, in + n, literals);
+                pos += literals;
+                n += literals;
+            }
+            return true;
+        }
+    }
+
+    template<class T, size_t history = 32>
+    class DeltaEncoder{
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        static_assert(history >= 2 && history <= std::numeric_limits<uint16_t>::max(), "history must be in [2, 65535].");
+        std::array<T, history> m_sent;      // indexed by seq % history
+        uint32_t m_seq;
+        int64_t m_acked;                    // newest acknowledged seq (-1: none)
+        DeltaMode m_mode;
+        uint32_t m_keyframeInterval;
+        uint32_t m_sinceKeyframe;
+        uint8_t m_epoch;
+
+    public:
+        DeltaEncoder() : m_seq(0), m_acked(-1), m_mode(DeltaMode::PREVIOUS), m_keyframeInterval(30), m_sinceKeyframe(0), m_epoch(0){}
+
+        void set_mode(DeltaMode mode){
+            m_mode = mode;
+        }
+
+        // PREVIOUS: a keyframe every `interval` items (0: only the first)
+        void set_keyframe_interval(uint32_t interval){
+            m_keyframeInterval = interval;
+        }
+
+        // ACKED: the receiver has decoded item `seq` (see DeltaDecoder::last())
+        void ack(uint32_t seq){
+            if (m_acked < 0 || static_cast<int32_t>(seq - static_cast<uint32_t>(m_acked)) > 0)
+                m_acked = seq;
+        }
+
+        void encode(const T &item, Delta<T> *out){
+            uint32_t distance = 0;
+            if (m_mode == DeltaMode::PREVIOUS){
+                if (m_seq > 0 && (m_keyframeInterval == 0 || m_sinceKeyframe < m_keyframeInterval - 1))
+                    distance = 1;
+            }
+            else if (m_acked >= 0){
+                const uint32_t d = m_seq - static_cast<uint32_t>(m_acked);
+                if (d > 0 && d < history)
+                    distance = d;
+            }
+            m_sinceKeyframe = distance ? m_sinceKeyframe+1 : 0;
+
+            uint8_t x[sizeof(T)];
+            memcpy(x, &item, sizeof(T));
+            if (distance)
+                simd::xor_into(x, reinterpret_cast<const uint8_t*>(&m_sent[(m_seq - distance)%history]), sizeof(T));
+
+            out->seq = m_seq;
+            out->distance = static_cast<uint16_t>(distance);
+            out->epoch = m_epoch;
+            const size_t n = delta::encode_zrle(x, sizeof(T), out->bytes);
+            // the rest to the end of the struct is zero, so wire_size() cuts it
+            memset(out->bytes + n, 0, sizeof(Delta<T>) - offsetof(Delta<T>, bytes) - n);
+
+            m_sent[m_seq%history] = item;
+            m_seq++;
+        }
+
+        void reset(){
+            m_seq = 0;
+            m_acked = -1;
+            m_sinceKeyframe = 0;
+            m_epoch++; // the decoder restarts at the new epoch
+        }
+    };
+
+    template<class T, size_t history = 32>
+    class DeltaDecoder{
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        static_assert(history >= 2, "history must be >= 2.");
+        std::array<T, history> m_items;             // indexed by seq % history
+        std::array<int64_t, history> m_seqs;        // seq of m_items (-1: empty)
+        int64_t m_last;
+        uint8_t m_epoch;
+
+    public:
+        DeltaDecoder() : m_last(-1), m_epoch(0){
+            m_seqs.fill(-1);
+        }
+
+        // Status::LOST: the baseline was lost (wait for a keyframe), or d is a delayed item
+        // of an old epoch. Status::INVALID_ARGUMENT: broken tokens
+        Status decode(const Delta<T> &d, T *out){
+            if (d.epoch != m_epoch){ // for encoder's reset
+                if (m_last >= 0 && static_cast<int8_t>(d.epoch - m_epoch) < 0)
+                    return Status::LOST;
+                reset();
+                m_epoch = d.epoch;
+            }
+            T item {};
+            if (d.distance){
+                const uint32_t base = d.seq - d.distance;
+                if (m_seqs[base%history] != base)
+                    return Status::LOST;
+                item = m_items[base%history];
+            }
+            if (not delta::apply_zrle(d.bytes, sizeof(d.bytes), reinterpret_cast<uint8_t*>(&item), sizeof(T)))
+                return Status::INVALID_ARGUMENT;
+            m_items[d.seq%history] = item;
+            m_seqs[d.seq%history] = d.seq;
+            if (m_last < 0 || static_cast<int32_t>(d.seq - static_cast<uint32_t>(m_last)) > 0)
+                m_last = d.seq;
+            *out = item;
+            return Status::OK;
+        }
+
+        // newest decoded item (-1: none), to acknowledge to the DeltaEncoder
+        int64_t last() const{
+            return m_last;
+        }
+
+        void reset(){
+            m_seqs.fill(-1);
+            m_last = -1;
+        }
+    };
+}
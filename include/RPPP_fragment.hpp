@@ -0,0 +1,346 @@
+#pragma once
+#include "RPPP.hpp"
+#include <cstddef>
+
+namespace rppp{
+
+    /*
+    fragmentation of messages larger than a packet (map chunks, large snapshots)
+
+    a message of up to max_message bytes is split into shards of `bytes` and is
+    its own parity group: k = ceil(size/bytes) data shards + P + Q of the P/Q
+    scheme of EncodeBuffer. the group has `shards` columns (shards+1 is prime)
+    and the columns k..shards-1 are virtual zero columns, which are neither
+    stored nor sent. any 2 lost shards of a message are recovered.
+
+    FragmentDecoder writes the shards into the message buffer of its window at
+    their offset: a message is contiguous there, and deq() returns a view of it
+    without another copy.
+
+        packet : FragmentHeader + shard, Fragment::wire_size() bytes on the wire
+                 (the last data shard and the trailing zeros of P / Q are cut)
+    */
+
+    // smallest number of shards (n+1 prime) whose columns hold max_message
+    constexpr int fragment_shards(size_t max_message, size_t shard_bytes){
+        int n = padded_size(2);
+        while (n*(shard_bytes/n*n) < max_message)
+            n = padded_size(n+1);
+        return n;
+    }
+
+    // 12 bytes
+    struct FragmentHeader{
+        uint32_t message;       // message number (wraps around)
+        uint32_t size;          // bytes of the message
+        uint16_t pos;           // 0..k-1 data, shards P, shards+1 Q
+        uint16_t reserved;
+    };
+
+    template<size_t bytes>
+    struct Fragment{
+        FragmentHeader header;
+        uint8_t data[bytes];
+
+        // bytes of the packet to send
+        size_t wire_size() const{
+            const size_t k = (header.size + bytes - 1)/bytes;
+            if (header.pos < k)
+                return offsetof(Fragment, data) + std::min(bytes, header.size - header.pos*bytes);
+            size_t n = bytes;
+            while (n > 0 && data[n-1] == 0)
+                n--;
+            return offsetof(Fragment, data) + n;
+        }
+    };
+
+    template<size_t max_message, size_t shard_bytes = 1400>
+    class FragmentEncoder{
+    public:
+        static constexpr int shards = fragment_shards(max_message, shard_bytes);
+        static constexpr size_t bytes = shard_bytes/shards*shards;   // of a column
+        using Packet = Fragment<bytes>;
+
+    private:
+        static_assert(max_message > 0, "max_message must be > 0.");
+        static_assert(shard_bytes >= 2, "shard_bytes is too small.");
+        static_assert(shards+2 <= std::numeric_limits<uint16_t>::max(), "max_message is too large for shard_bytes.");
+        static constexpr size_t block_bytes = bytes/shards;
+        alignas(64) std::array<uint8_t, bytes> m_p;                          // horizonal parity
+        alignas(64) std::array<std::array<uint8_t, block_bytes>, shards+1> m_q; // diagonal parity (see pq::accumulate_q)
+        RingBuffer<Packet, shards+2> m_outBuf;                               // a message of max_message
+        uint32_t m_message;
+
+    public:
+        FragmentEncoder() : m_p{}, m_q{}, m_message(0){}
+
+        // Status::BUFFER_FULL: deq() the packets of the previous messages first
+        Status enq(const void *message, size_t size){
+            if (size == 0 || size > max_message)
+                return Status::INVALID_ARGUMENT;
+            const int k = static_cast<int>((size + bytes - 1)/bytes);
+            if (m_outBuf.free() < static_cast<size_t>(k+2))
+                return Status::BUFFER_FULL;
+
+            m_p = {};
+            m_q = {};
+            const uint8_t *src = static_cast<const uint8_t*>(message);
+            for (int c=0; c<k; c++){
+                Packet& f = push_header(c, size);
+                const size_t len = std::min(bytes, size - c*bytes);
+                memcpy(f.data, src + c*bytes, len);
+                memset(f.data + len, 0, bytes - len);
+                simd::xor_into(m_p.data(), f.data, bytes);
+                accumulate_q(c, f.data);
+            }
+            memcpy(push_header(shards, size).data, m_p.data(), bytes);
+            accumulate_q(shards, m_p.data());
+            Packet& q = push_header(shards+1, size);
+            for (int j=0; j<shards; j++)
+                memcpy(q.data + j*block_bytes, m_q[shards-j].data(), block_bytes);
+
+            m_message++;
+            return Status::OK_PARITY_GENERATED;
+        }
+
+        Status deq(Packet *pf){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            *pf = m_outBuf.front();
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        // front of the output without copy. (nullptr if empty)
+        // valid until the next pop(), enq() or reset().
+        const Packet* peek() const{
+            if (m_outBuf.empty())
+                return nullptr;
+            return &m_outBuf.front();
+        }
+
+        Status pop(){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        void reset(){
+            m_outBuf.clear();
+            m_message = 0;
+        }
+
+        size_t count(){
+            return m_outBuf.size();
+        }
+
+    private:
+        inline Packet& push_header(int pos, size_t size){
+            Packet& f = m_outBuf.push_back();
+            f.header = {m_message, static_cast<uint32_t>(size), static_cast<uint16_t>(pos), 0};
+            return f;
+        }
+        inline void accumulate_q(int c, const uint8_t *data){
+            pq::accumulate_q(m_q[0].data(), shards, c, data, block_bytes);
+        }
+    };
+
+    /*
+    reorder_messages: number of messages in flight.
+    a message is decoded as soon as it is complete or recoverable, and given up
+    when a packet of the message reorder_messages ahead arrives (or by finish()).
+    messages are output in order.
+    */
+    template<size_t max_message, size_t shard_bytes = 1400, int reorder_messages = 2>
+    class FragmentDecoder{
+    public:
+        static constexpr int shards = FragmentEncoder<max_message, shard_bytes>::shards;
+        static constexpr size_t bytes = FragmentEncoder<max_message, shard_bytes>::bytes;
+        using Packet = Fragment<bytes>;
+
+    private:
+        static_assert(reorder_messages >= 1, "reorder_messages must be >= 1.");
+        static constexpr size_t block_bytes = bytes/shards;
+        static constexpr RecoverySchedule<shards> s_schedule {};
+        struct Message{
+            alignas(64) std::array<uint8_t, (shards+2)*bytes> cells;   // data columns (the message), P, Q
+            std::array<bool, shards+2> received;
+            int received_cnt;   // the virtual columns included
+            int k;              // data shards
+            uint32_t size;
+            int64_t number;
+            bool decoded;
+            bool recovered;
+            bool used;
+        };
+        std::array<Message, reorder_messages> m_window;     // indexed by message number % reorder_messages
+        int64_t m_base;                                     // oldest message not output
+        int64_t m_last;                                     // newest message received
+        int64_t m_gap;                                      // given up messages before m_base, not reported
+        bool m_flag_first_call;
+        bool m_finish;
+
+    public:
+        FragmentDecoder() : m_base(0), m_last(-1), m_gap(0), m_flag_first_call(true), m_finish(false){
+            for (auto& m : m_window)
+                m.used = false;
+        }
+
+        // a packet of len bytes. Status::BUFFER_FULL: deq() the decoded messages first
+        Status enq(const void *packet, size_t len){
+            FragmentHeader h;
+            // not sizeof(Packet): it has tail padding when bytes is not a multiple of 4
+            if (len < offsetof(Packet, data) || len > offsetof(Packet, data) + bytes)
+                return Status::INVALID_ARGUMENT;
+            memcpy(&h, packet, sizeof(h));
+            if (h.size == 0 || h.size > max_message)
+                return Status::INVALID_ARGUMENT;
+            const int k = static_cast<int>((h.size + bytes - 1)/bytes);
+            if (h.pos >= shards+2 || (h.pos >= k && h.pos < shards))
+                return Status::INVALID_ARGUMENT;
+
+            if (m_flag_first_call){
+                m_base = h.message;
+                m_last = m_base - 1;
+                m_flag_first_call = false;
+            }
+            const int64_t diff = static_cast<int32_t>(h.message - static_cast<uint32_t>(m_base));
+            if (diff < 0)
+                return Status::OK; // given up or output
+            const int64_t number = m_base + diff;
+            if (diff >= reorder_messages){
+                // give up the oldest messages (not the decoded ones)
+                for (int64_t i=m_base; i<=number-reorder_messages && i<m_base+reorder_messages; i++){
+                    const Message& m = m_window[i%reorder_messages];
+                    if (m.used && m.number == i && m.decoded)
+                        return Status::BUFFER_FULL;
+                }
+                give_up(number - reorder_messages + 1);
+            }
+
+            Message& m = m_window[number%reorder_messages];
+            if (not m.used || m.number != number)
+                open(m, number, h.size, k);
+            else if (m.size != h.size)
+                return Status::INVALID_ARGUMENT;
+            m_last = std::max(m_last, number);
+            if (m.received[h.pos] || m.decoded) // duplicated
+                return Status::OK;
+
+            const size_t payload = len - offsetof(Packet, data);
+            uint8_t *dst = column(m, h.pos);
+            memcpy(dst, static_cast<const uint8_t*>(packet) + offsetof(Packet, data), payload);
+            memset(dst + payload, 0, bytes - payload);
+            m.received[h.pos] = true;
+            m.received_cnt++;
+            if (m.received_cnt >= shards)
+                decode(m);
+            return Status::OK;
+        }
+
+        // the next message in order: *message is valid until the next enq() or reset().
+        // Status::LOST: messages [info->index, info->index + info->lost) are given up
+        Status deq(span<const uint8_t> *message, ItemInfo *info){
+            if (m_gap){
+                *info = {static_cast<uint64_t>(m_base - m_gap), static_cast<uint64_t>(m_gap), false};
+                m_gap = 0;
+                return Status::LOST;
+            }
+            Message& m = m_window[m_base%reorder_messages];
+            if (m.used && m.number == m_base && m.decoded){
+                *message = span<const uint8_t>(m.cells.data(), m.size);
+                *info = {static_cast<uint64_t>(m_base), 0, m.recovered};
+                m.used = false;
+                m_base++;
+                return Status::OK;
+            }
+            if (m_finish && m_base <= m_last){
+                give_up(m_base + 1);
+                return deq(message, info);
+            }
+            m_finish = false;
+            return Status::NO_ELEMENT;
+        }
+
+        // given up messages are skipped
+        Status deq(span<const uint8_t> *message){
+            ItemInfo info;
+            Status status;
+            while ((status = deq(message, &info)) == Status::LOST){}
+            return status;
+        }
+
+        void reset(){
+            for (auto& m : m_window)
+                m.used = false;
+            m_base = 0;
+            m_last = -1;
+            m_gap = 0;
+            m_flag_first_call = true;
+            m_finish = false;
+        }
+
+        // give up the messages in flight when deq() reaches them (e.g. at the end of the stream)
+        void finish(){
+            m_finish = true;
+        }
+
+        // messages in the window
+        size_t in_flight() const{
+            size_t n = 0;
+            for (auto& m : m_window)
+                n += m.used;
+            return n;
+        }
+
+    private:
+        inline void open(Message& m, int64_t number, uint32_t size, int k){
+            m.received = {};
+            for (int c=k; c<shards; c++)
+                m.received[c] = true;
+            m.received_cnt = shards - k;
+            m.k = k;
+            m.size = size;
+            m.number = number;
+            m.decoded = false;
+            m.recovered = false;
+            m.used = true;
+        }
+
+        // give up the messages before `until` (they are not decoded)
+        inline void give_up(int64_t until){
+            if (until <= m_base)
+                return;
+            for (auto& m : m_window){
+                if (m.used && m.number < until)
+                    m.used = false;
+            }
+            m_gap += until - m_base;
+            m_base = until;
+        }
+
+        inline void decode(Message& m){
+            // lost columns of data and P (shards received, so at most 2)
+            std::array<int, 2> lost;
+            int lost_num = 0;
+            for (int c=0; c<shards+1 && lost_num<2; c++){
+                if (not m.received[c])
+                    lost[lost_num++] = c;
+            }
+            // P is the column `shards` of the geometry, and the virtual zero columns m.k..shards-1 are skipped
+            const pq::Columns cols {m.cells.data(), bytes, column(m, shards), column(m, shards+1), block_bytes, shards, m.k};
+            if (lost_num == 1)
+                pq::recover_column<shards>(cols, lost[0]);
+            else if (lost_num == 2)
+                pq::recover_pair<shards>(cols, lost[0], lost[1], s_schedule.mid(lost[0], lost[1]), 0, block_bytes);
+            m.recovered = lost_num && lost[0] < shards;
+            m.decoded = true;
+        }
+
+        // column c (data, P, Q) of the message
+        inline uint8_t* column(Message& m, int c){
+            return m.cells.data() + c*bytes;
+        }
+    };
+}
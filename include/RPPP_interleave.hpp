@@ -0,0 +1,191 @@
+#pragma once
+#include "RPPP.hpp"
+
+namespace rppp{
+
+    /*
+    burst loss interleaving
+
+    consecutive items go round-robin into `depth` independent parity groups (lanes),
+    and packets are sent in a strict lane rotation:
+
+        depth = 2, parity_size = 2
+        item   : 0  1  2  3
+        packet : a0 b0 a1 b1 aP bP aQ bQ    (a, b = lane)
+
+    any 2*depth consecutive packets hit each lane at most twice, so a burst of up
+    to 2*depth packets is recovered. the bandwidth is the same as EncodeBuffer.
+    the lane is sent in Header::lane.
+    */
+    template<class T, int parity_size, int depth>
+    class InterleaveEncoder{
+        static_assert(depth >= 1, "depth must be >= 1.");
+        static_assert(depth <= std::numeric_limits<uint8_t>::max()+1, "depth must be <= 256.");
+        std::array<EncodeBuffer<T, parity_size>, depth> m_lanes;
+        int m_inLane;   // lane of the next item
+        int m_outLane;  // lane of the next packet
+
+    public:
+        InterleaveEncoder() : m_inLane(0), m_outLane(0){
+            for (int i=0; i<depth; i++)
+                m_lanes[i].set_lane(static_cast<uint8_t>(i));
+        }
+
+        Status enq(const T &item){
+            Status status = m_lanes[m_inLane].enq(item);
+            if (status == Status::BUFFER_FULL)
+                return status;
+            m_inLane = (m_inLane+1)%depth;
+            return status;
+        }
+
+        Status deq(StreamData<T, parity_size>* psd){
+            const StreamData<T, parity_size>* front = peek();
+            if (front == nullptr)
+                return Status::NO_ELEMENT;
+            *psd = *front;
+            return pop();
+        }
+
+        // front of the output without copy. (nullptr if the next lane has no packet yet)
+        const StreamData<T, parity_size>* peek() const{
+            return m_lanes[m_outLane].peek();
+        }
+
+        Status pop(){
+            if (m_lanes[m_outLane].pop() == Status::NO_ELEMENT)
+                return Status::NO_ELEMENT;
+            m_outLane = (m_outLane+1)%depth;
+            return Status::OK;
+        }
+
+        void reset(){
+            for (auto& lane : m_lanes)
+                lane.reset();
+            m_inLane = 0;
+            m_outLane = 0;
+        }
+
+        // packets ready to send (in the lane rotation)
+        size_t count(){
+            size_t ret = 0;
+            while (m_lanes[(m_outLane+ret)%depth].count() > ret/depth)
+                ret++;
+            return ret;
+        }
+    };
+
+    /*
+    decoder of InterleaveEncoder.
+    packets are routed to the lane decoders by Header::lane, and the items are
+    merged back in the original order: item i is item i/depth of the lane i%depth.
+    */
+    template<class T, int parity_size, int depth, int reorder_groups = 2>
+    class InterleaveDecoder{
+        static_assert(depth >= 1, "depth must be >= 1.");
+        static_assert(depth <= std::numeric_limits<uint8_t>::max()+1, "depth must be <= 256.");
+        struct Pending{
+            T item;
+            ItemInfo info;
+            bool valid;
+        };
+        std::array<DecodeBuffer<T, parity_size, reorder_groups>, depth> m_lanes;
+        std::array<Pending, depth> m_pending;   // the front output of each lane
+        uint64_t m_index;                       // index of the next item
+        uint8_t m_epoch;
+        bool m_started;
+        bool m_aligned;                         // m_index is set from the first item of the lane 0
+
+    public:
+        InterleaveDecoder() : m_pending{}, m_index(0), m_epoch(0), m_started(false), m_aligned(false){}
+
+        Status enq(const StreamData<T, parity_size> &sd){
+            if (sd.header.lane >= depth)
+                return Status::OK; // not a packet of this stream
+            if (m_started && sd.header.epoch != m_epoch){
+                if (static_cast<int8_t>(sd.header.epoch - m_epoch) < 0)
+                    return Status::OK; // delayed packet of an old epoch
+                reset(); // the encoder's reset
+            }
+            m_epoch = sd.header.epoch;
+            m_started = true;
+            return m_lanes[sd.header.lane].enq(sd);
+        }
+
+        // given up items are skipped
+        Status deq(T *p){
+            ItemInfo info;
+            Status status;
+            while ((status = deq(p, &info)) == Status::LOST);
+            return status;
+        }
+
+        // Status::LOST: the item info->index is given up. (*p is not written)
+        Status deq(T *p, ItemInfo *info){
+            for (;;){
+                const int lane = m_index%depth;
+                const uint64_t local = m_index/depth;
+                Pending& pending = m_pending[lane];
+                if (not pending.valid){
+                    if (m_lanes[lane].deq(&pending.item, &pending.info) == Status::NO_ELEMENT)
+                        return Status::NO_ELEMENT;
+                    pending.valid = true;
+                    if (not m_aligned && lane == 0){ // the first item of the stream
+                        m_index = pending.info.index*depth;
+                        m_aligned = true;
+                    }
+                    continue;
+                }
+
+                const uint64_t first = pending.info.index;
+                const uint64_t last = first + std::max<uint64_t>(pending.info.lost, 1); // [first, last)
+                if (local >= last){ // already given up in the other lanes
+                    pending.valid = false;
+                    continue;
+                }
+                *info = {m_index++, 1, false};
+                if (local < first) // skipped by the lane decoder
+                    return Status::LOST;
+                if (pending.info.lost){
+                    if (local+1 == last)
+                        pending.valid = false;
+                    return Status::LOST;
+                }
+                memcpy(p, &pending.item, sizeof(T));
+                info->lost = 0;
+                info->recovered = pending.info.recovered;
+                pending.valid = false;
+                return Status::OK;
+            }
+        }
+
+        using Clock = typename DecodeBuffer<T, parity_size, reorder_groups>::Clock;
+
+        void set_deadline(typename Clock::duration deadline){
+            for (auto& lane : m_lanes)
+                lane.set_deadline(deadline);
+        }
+
+        void poll(typename Clock::time_point now = Clock::now()){
+            for (auto& lane : m_lanes)
+                lane.poll(now);
+        }
+
+        void reset(){
+            for (auto& lane : m_lanes)
+                lane.reset();
+            m_pending = {};
+            m_index = 0;
+            m_started = false;
+            m_aligned = false;
+        }
+
+        // items waiting in the lanes (not merged yet)
+        size_t count(){
+            size_t ret = 0;
+            for (int i=0; i<depth; i++)
+                ret += m_lanes[i].count() + (m_pending[i].valid && not m_pending[i].info.lost);
+            return ret;
+        }
+    };
+}
@@ -0,0 +1,258 @@
+#pragma once
+#include "RPPP_session.hpp"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+namespace rppp{
+
+    /*
+    work-stealing thread pool
+
+    run() splits [0, n) in halves down to `grain` items: a thread keeps working on
+    the first half and pushes the second half to the back of its own queue, and
+    idle threads steal from the front of the other queues (the largest ranges).
+    the caller works too, and run() returns when the whole range is done. tasks
+    may call run() again (a worker waits by working).
+
+        WorkStealingPool pool(std::thread::hardware_concurrency() - 1);
+        pool.parallel_for(sessions.slots(), 16, [&](size_t begin, size_t end){ ... });
+        decoder.set_splitter(pool.splitter());  // large groups in column ranges
+
+    run() from outside of the pool is for one thread at a time.
+    */
+    class WorkStealingPool{
+        struct Job{
+            void (*task)(void*, size_t, size_t);
+            void *arg;
+            size_t grain;
+            std::atomic<size_t> remaining;  // items not done
+        };
+        struct Range{
+            Job *job;
+            size_t begin;
+            size_t end;
+        };
+        // a stack for the owner (back) and a queue for thieves (front)
+        struct alignas(64) Queue{
+            std::mutex mutex;
+            std::vector<Range> ranges;
+            size_t head = 0;
+        };
+        static constexpr size_t column_grain = 4096;    // bytes of a column range task
+
+        std::vector<std::unique_ptr<Queue>> m_queues;   // workers, and the caller's at the end
+        std::vector<std::thread> m_threads;
+        std::atomic<size_t> m_queued;
+        std::atomic<size_t> m_sleeping;
+        std::atomic<bool> m_stop;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+
+        // the pool and the queue of a worker thread
+        struct Worker{
+            const WorkStealingPool *pool;
+            int index;
+        };
+        static Worker& worker(){
+            static thread_local Worker w {nullptr, -1};
+            return w;
+        }
+
+    public:
+        // workers: threads besides the caller (0: run() works alone)
+        explicit WorkStealingPool(unsigned workers) : m_queued(0), m_sleeping(0), m_stop(false){
+            for (unsigned i=0; i<workers+1; i++)
+                m_queues.emplace_back(new Queue());
+            for (unsigned i=0; i<workers; i++)
+                m_threads.emplace_back([this, i]{ work(static_cast<int>(i)); });
+        }
+
+        ~WorkStealingPool(){
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& thread : m_threads)
+                thread.join();
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // threads which run the tasks (workers + the caller)
+        size_t concurrency() const{
+            return m_queues.size();
+        }
+
+        // task(arg, begin, end) over [0, n)
+        void run(size_t n, size_t grain, void (*task)(void*, size_t, size_t), void *arg){
+            if (n == 0)
+                return;
+            Job job {task, arg, std::max<size_t>(grain, 1), {n}};
+            if (m_threads.empty() || n <= job.grain){
+                task(arg, 0, n);
+                return;
+            }
+            const int self = (worker().pool == this) ? worker().index : static_cast<int>(m_queues.size()-1);
+            push(self, {&job, 0, n});
+            while (job.remaining.load(std::memory_order_acquire) != 0){
+                Range r;
+                if (pop(self, r) || steal(self, r))
+                    execute(self, r);
+                else
+                    std::this_thread::yield();
+            }
+        }
+
+        // f(begin, end) over [0, n)
+        template<class F>
+        void parallel_for(size_t n, size_t grain, F&& f){
+            using Fn = std::remove_reference_t<F>;
+            run(n, grain, [](void *arg, size_t begin, size_t end){ (*static_cast<Fn*>(arg))(begin, end); }, &f);
+        }
+
+        // for EncodeBuffer / DecodeBuffer::set_splitter(): blocks of min_bytes or more are split
+        ColumnSplitter splitter(size_t min_bytes = 4*column_grain){
+            ColumnSplitter s;
+            s.run = [](void *ctx, size_t n, void (*task)(void*, size_t, size_t), void *arg){
+                static_cast<WorkStealingPool*>(ctx)->run(n, column_grain, task, arg);
+            };
+            s.ctx = this;
+            s.min_bytes = min_bytes;
+            return s;
+        }
+
+    private:
+        void work(int self){
+            worker() = {this, self};
+            for (;;){
+                Range r;
+                if (pop(self, r) || steal(self, r)){
+                    execute(self, r);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_sleeping++;
+                m_wake.wait(lock, [&]{ return m_stop || m_queued.load() > 0; });
+                m_sleeping--;
+                if (m_stop)
+                    return;
+            }
+        }
+
+        inline void execute(int self, Range r){
+            while (r.end - r.begin > r.job->grain){
+                const size_t mid = r.begin + (r.end - r.begin)/2;
+                push(self, {r.job, mid, r.end});
+                r.end = mid;
+            }
+            r.job->task(r.job->arg, r.begin, r.end);
+            r.job->remaining.fetch_sub(r.end - r.begin, std::memory_order_acq_rel);
+        }
+
+        inline void push(int self, const Range& r){
+            Queue& q = *m_queues[self];
+            {
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.ranges.push_back(r);
+            }
+            m_queued++;
+            if (m_sleeping.load() > 0){
+                { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+                m_wake.notify_one();
+            }
+        }
+
+        inline bool pop(int self, Range& r){
+            Queue& q = *m_queues[self];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.head == q.ranges.size())
+                return false;
+            r = q.ranges.back();
+            q.ranges.pop_back();
+            taken(q);
+            return true;
+        }
+
+        inline bool steal(int self, Range& r){
+            if (m_queued.load(std::memory_order_relaxed) == 0)
+                return false;
+            const size_t num = m_queues.size();
+            for (size_t k=1; k<num; k++){
+                Queue& q = *m_queues[(self+k)%num];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                if (q.head == q.ranges.size())
+                    continue;
+                r = q.ranges[q.head++];
+                taken(q);
+                return true;
+            }
+            return false;
+        }
+
+        inline void taken(Queue& q){
+            if (q.head == q.ranges.size()){
+                q.ranges.clear();
+                q.head = 0;
+            }
+            m_queued--;
+        }
+    };
+
+    /*
+    SessionManager::enq_batch() on a WorkStealingPool
+
+    the packets are routed on the caller's thread, and the packets of each session
+    are decoded in order by a task, so the sessions recover in parallel.
+    */
+    template<class Manager>
+    class ParallelRouter{
+        using Session = typename Manager::Session;
+        using Datagram = typename Manager::Datagram;
+        std::vector<std::pair<Session*, uint32_t>> m_order;    // session, index of the packet
+        std::vector<uint32_t> m_runs;                           // first packet of each session in m_order
+
+    public:
+        // returns the number of routed packets
+        size_t enq_batch(WorkStealingPool& pool, Manager& sessions, span<const Datagram> datagrams){
+            m_order.clear();
+            for (size_t i=0; i<datagrams.size(); i++){
+                Session* s = sessions.route(datagrams[i].flow);
+                if (s)
+                    m_order.push_back({s, static_cast<uint32_t>(i)});
+            }
+            std::sort(m_order.begin(), m_order.end());
+            m_runs.clear();
+            for (size_t i=0; i<m_order.size(); i++){
+                if (i == 0 || m_order[i].first != m_order[i-1].first)
+                    m_runs.push_back(static_cast<uint32_t>(i));
+            }
+            m_runs.push_back(static_cast<uint32_t>(m_order.size()));
+
+            pool.parallel_for(m_runs.size()-1, 1, [&](size_t begin, size_t end){
+                for (size_t run=begin; run<end; run++){
+                    for (uint32_t i=m_runs[run]; i<m_runs[run+1]; i++)
+                        m_order[i].first->decoder.enq(*datagrams[m_order[i].second].data);
+                }
+            });
+            return m_order.size();
+        }
+    };
+
+    // f(Session&) for every open session, `grain` slots in a task
+    template<class Manager, class F>
+    void parallel_for_each(WorkStealingPool& pool, Manager& sessions, size_t grain, F&& f){
+        pool.parallel_for(sessions.slots(), grain, [&](size_t begin, size_t end){
+            for (size_t i=begin; i<end; i++){
+                if (auto* s = sessions.at(i))
+                    f(*s);
+            }
+        });
+    }
+}
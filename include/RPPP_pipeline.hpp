@@ -0,0 +1,221 @@
+#pragma once
+#include "RPPP.hpp"
+#include <atomic>
+
+namespace rppp{
+
+    /*
+    single producer / single consumer lock-free ring
+
+    push() is called by one thread and pop() by another, and neither waits.
+    head and tail are on their own cache lines, and each side keeps a copy of
+    the other side's index so the shared one is read only when the ring looks
+    full (or empty).
+    */
+    template<class T, size_t capacity>
+    class SpscRing{
+        static_assert(capacity >= 2 && (capacity & (capacity-1)) == 0, "capacity must be a power of 2.");
+        static constexpr size_t mask = capacity-1;
+        static constexpr size_t line = 64;
+
+        alignas(line) std::atomic<size_t> m_head;   // written by the consumer
+        size_t m_tailCache;                         // consumer's copy of m_tail
+        alignas(line) std::atomic<size_t> m_tail;   // written by the producer
+        size_t m_headCache;                         // producer's copy of m_head
+        alignas(line) std::array<T, capacity> m_buf;
+
+    public:
+        SpscRing() : m_head(0), m_tailCache(0), m_tail(0), m_headCache(0){}
+
+        // producer
+        bool push(const T &item){
+            T* slot = back();
+            if (slot == nullptr)
+                return false;
+            *slot = item;
+            commit();
+            return true;
+        }
+
+        // producer: the free slot to write (nullptr: full), published by commit()
+        T* back(){
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_headCache == capacity){
+                m_headCache = m_head.load(std::memory_order_acquire);
+                if (tail - m_headCache == capacity)
+                    return nullptr;
+            }
+            return &m_buf[tail & mask];
+        }
+        void commit(){
+            m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // consumer
+        bool pop(T *p){
+            const T* slot = front();
+            if (slot == nullptr)
+                return false;
+            *p = *slot;
+            release();
+            return true;
+        }
+
+        // consumer: the oldest item (nullptr: empty), freed by release()
+        const T* front(){
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tailCache){
+                m_tailCache = m_tail.load(std::memory_order_acquire);
+                if (head == m_tailCache)
+                    return nullptr;
+            }
+            return &m_buf[head & mask];
+        }
+        void release(){
+            m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // approximate from the other thread
+        size_t size() const{
+            return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+        }
+    };
+
+    /*
+    EncodeBuffer between two threads (e.g. game thread -> network thread)
+
+    enq() is called by the producer and deq() by the consumer. the items go
+    through a SpscRing, and the parity is computed in deq() on the consumer's
+    thread, which owns the EncodeBuffer. enq() returns BUFFER_FULL instead of
+    waiting when `capacity` items are queued.
+    */
+    template<class T, int parity_size, size_t capacity = 1024, class H = Header>
+    class PipelineEncoder{
+        SpscRing<T, capacity> m_ring;
+        EncodeBuffer<T, parity_size, H> m_encoder;
+
+    public:
+        // producer
+        Status enq(const T &item){
+            return m_ring.push(item) ? Status::OK : Status::BUFFER_FULL;
+        }
+
+        // consumer
+        Status deq(StreamData<T, parity_size, H>* psd){
+            for (;;){
+                if (m_encoder.deq(psd) == Status::OK)
+                    return Status::OK;
+                const T* item = m_ring.front();
+                if (item == nullptr)
+                    return Status::NO_ELEMENT;
+                m_encoder.enq(*item);
+                m_ring.release();
+            }
+        }
+
+        // consumer
+        void reset(){
+            T item;
+            while (m_ring.pop(&item)){}
+            m_encoder.reset();
+        }
+
+        // items queued by the producer (approximate from the producer)
+        size_t queued() const{
+            return m_ring.size();
+        }
+    };
+
+    /*
+    DecodeBuffer between two threads (e.g. network thread -> game thread)
+
+    enq() is called by the producer, which decodes, and the items are passed to
+    deq() on the consumer's thread through a SpscRing. when the ring is full the
+    items wait in the DecodeBuffer and are moved by the next enq() or poll()
+    (the DecodeBuffer holds up to parity_size*(reorder_groups+1), see waiting()).
+    */
+    template<class T, int parity_size, size_t capacity = 1024, int reorder_groups = 2, class H = Header>
+    class PipelineDecoder{
+        struct Output{
+            T item;
+            ItemInfo info;
+            Status status;      // OK or LOST
+        };
+        using Decoder = DecodeBuffer<T, parity_size, reorder_groups, H>;
+        SpscRing<Output, capacity> m_ring;
+        Decoder m_decoder;
+
+    public:
+        using Clock = typename Decoder::Clock;
+
+        // producer. the settings are applied before the threads start
+        Decoder& decoder(){
+            return m_decoder;
+        }
+
+        // producer
+        Status enq(const StreamData<T, parity_size, H> &sd){
+            Status status = m_decoder.enq(sd);
+            transfer();
+            return status;
+        }
+        Status enq(const StreamData<T, parity_size, H> &sd, typename Clock::time_point now){
+            Status status = m_decoder.enq(sd, now);
+            transfer();
+            return status;
+        }
+
+        // producer: deadlines, and items which waited for a full ring
+        void poll(typename Clock::time_point now = Clock::now()){
+            m_decoder.poll(now);
+            transfer();
+        }
+
+        // producer: items in the DecodeBuffer which wait for the full ring.
+        // hold back enq() while it is not 0, or they may be dropped
+        size_t waiting(){
+            return m_decoder.count();
+        }
+
+        // consumer. given up items are skipped
+        Status deq(T *p){
+            for (;;){
+                const Output* out = m_ring.front();
+                if (out == nullptr)
+                    return Status::NO_ELEMENT;
+                const bool ok = out->status == Status::OK;
+                if (ok)
+                    memcpy(p, &out->item, sizeof(T));
+                m_ring.release();
+                if (ok)
+                    return Status::OK;
+            }
+        }
+
+        // consumer. Status::LOST: items [info->index, info->index + info->lost) are given up
+        Status deq(T *p, ItemInfo *info){
+            const Output* out = m_ring.front();
+            if (out == nullptr)
+                return Status::NO_ELEMENT;
+            const Status status = out->status;
+            *info = out->info;
+            if (status == Status::OK)
+                memcpy(p, &out->item, sizeof(T));
+            m_ring.release();
+            return status;
+        }
+
+    private:
+        inline void transfer(){
+            for (;;){
+                Output* slot = m_ring.back();
+                if (slot == nullptr)
+                    return;
+                slot->status = m_decoder.deq(&slot->item, &slot->info);
+                if (slot->status == Status::NO_ELEMENT)
+                    return;
+                m_ring.commit();
+            }
+        }
+    };
+}
@@ -0,0 +1,456 @@
+#pragma once
+#include "RPPP.hpp"
+#if RPPP_XOR_X86
+#include <immintrin.h>
+#endif
+
+namespace rppp{
+
+    /*
+    GF(2^8) arithmetic (polynomial x^8 + x^4 + x^3 + x^2 + 1)
+
+    the bulk operation is dst ^= c * src. c * x is split into the products of
+    the low and high nibbles of x, which are 16 entry tables, so a vector of
+    bytes is multiplied by two PSHUFB. the kernel is selected once like the
+    xor kernels (SSSE3 / AVX2, or a 256 entry row of the product table).
+    */
+    namespace gf256{
+        struct Tables{
+            uint8_t exp[512];
+            uint8_t log[256];
+            uint8_t mul[256][256];
+            alignas(16) uint8_t lo[256][16];    // c * x     (x = 0..15)
+            alignas(16) uint8_t hi[256][16];    // c * (x<<4)
+
+            Tables(){
+                int x = 1;
+                for (int i=0; i<255; i++){
+                    exp[i] = exp[i+255] = static_cast<uint8_t>(x);
+                    log[x] = static_cast<uint8_t>(i);
+                    x <<= 1;
+                    if (x & 0x100)
+                        x ^= 0x11d;
+                }
+                exp[510] = exp[511] = exp[0];
+                log[0] = 0;
+                for (int a=0; a<256; a++){
+                    for (int b=0; b<256; b++)
+                        mul[a][b] = (a && b) ? exp[log[a] + log[b]] : 0;
+                    for (int n=0; n<16; n++){
+                        lo[a][n] = mul[a][n];
+                        hi[a][n] = mul[a][n << 4];
+                    }
+                }
+            }
+        };
+
+        inline const Tables& tables(){
+            static const Tables t;
+            return t;
+        }
+
+        inline uint8_t mul(uint8_t a, uint8_t b){
+            return tables().mul[a][b];
+        }
+        // a != 0
+        inline uint8_t inv(uint8_t a){
+            return tables().exp[255 - tables().log[a]];
+        }
+
+        using mul_acc_t = void (*)(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len);
+
+        enum GfIsa{
+            PORTABLE,
+            SSSE3,
+            AVX2,
+        };
+
+        struct GfKernel{
+            GfIsa isa;
+            const char *name;
+            mul_acc_t mul_acc;      // dst ^= c * src
+        };
+
+        inline void mul_acc_portable(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len){
+            const uint8_t *row = tables().mul[c];
+            for (size_t i=0; i<len; i++)
+                dst[i] ^= row[src[i]];
+        }
+
+    #if RPPP_XOR_X86
+        __attribute__((target("ssse3")))
+        inline void mul_acc_ssse3(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len){
+            const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(tables().lo[c]));
+            const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(tables().hi[c]));
+            const __m128i mask = _mm_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i+16 <= len; i += 16){
+                __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i));
+                __m128i p = _mm_xor_si128(
+                    _mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+                    _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst+i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), _mm_xor_si128(d, p));
+            }
+            mul_acc_portable(dst+i, src+i, c, len-i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void mul_acc_avx2(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len){
+            const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(tables().lo[c])));
+            const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(tables().hi[c])));
+            const __m256i mask = _mm256_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i+32 <= len; i += 32){
+                __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src+i));
+                __m256i p = _mm256_xor_si256(
+                    _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+                    _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst+i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+i), _mm256_xor_si256(d, p));
+            }
+            mul_acc_ssse3(dst+i, src+i, c, len-i);
+        }
+    #endif
+
+        inline bool gf_isa_supported(GfIsa isa){
+            switch (isa){
+            case GfIsa::PORTABLE:
+                return true;
+    #if RPPP_XOR_X86
+            case GfIsa::SSSE3:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("ssse3");
+            case GfIsa::AVX2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+    #endif
+            default:
+                return false;
+            }
+        }
+
+        // kernel of the given isa. (the caller has to check gf_isa_supported())
+        inline GfKernel gf_kernel_for(GfIsa isa){
+            switch (isa){
+    #if RPPP_XOR_X86
+            case GfIsa::SSSE3: return {isa, "ssse3", mul_acc_ssse3};
+            case GfIsa::AVX2:  return {isa, "avx2", mul_acc_avx2};
+    #endif
+            default:           return {GfIsa::PORTABLE, "portable", mul_acc_portable};
+            }
+        }
+
+        // the best kernel for the running cpu. (detected on the first call)
+        inline const GfKernel& gf_kernel(){
+            static const GfKernel kernel = []{
+                tables();
+                for (GfIsa isa : {GfIsa::AVX2, GfIsa::SSSE3}){
+                    if (gf_isa_supported(isa))
+                        return gf_kernel_for(isa);
+                }
+                return gf_kernel_for(GfIsa::PORTABLE);
+            }();
+            return kernel;
+        }
+
+        // dst ^= c * src
+        inline void mul_acc(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len){
+            if (c == 0)
+                return;
+            if (c == 1){
+                simd::xor_into(dst, src, len);
+                return;
+            }
+            gf_kernel().mul_acc(dst, src, c, len);
+        }
+
+        // in-place inverse of a n x n matrix (row major, stride n, n <= max_n). false if singular
+        template<int max_n>
+        inline bool invert(uint8_t *a, int n){
+            std::array<uint8_t, max_n*max_n> inverse {};
+            uint8_t *b = inverse.data();
+            for (int i=0; i<n; i++)
+                b[i*n + i] = 1;
+            for (int col=0; col<n; col++){
+                int pivot = col;
+                while (pivot < n && a[pivot*n + col] == 0)
+                    pivot++;
+                if (pivot == n)
+                    return false;
+                if (pivot != col){
+                    for (int k=0; k<n; k++){
+                        std::swap(a[pivot*n + k], a[col*n + k]);
+                        std::swap(b[pivot*n + k], b[col*n + k]);
+                    }
+                }
+                const uint8_t f = inv(a[col*n + col]);
+                for (int k=0; k<n; k++){
+                    a[col*n + k] = mul(a[col*n + k], f);
+                    b[col*n + k] = mul(b[col*n + k], f);
+                }
+                for (int row=0; row<n; row++){
+                    const uint8_t g = a[row*n + col];
+                    if (row == col || g == 0)
+                        continue;
+                    for (int k=0; k<n; k++){
+                        a[row*n + k] ^= mul(g, a[col*n + k]);
+                        b[row*n + k] ^= mul(g, b[col*n + k]);
+                    }
+                }
+            }
+            memcpy(a, b, n*n);
+            return true;
+        }
+    }
+
+    /*
+    Reed-Solomon codec (systematic Cauchy code over GF(2^8))
+
+    a group is data_size items and parity_count parity packets, and any
+    parity_count lost packets of a group are recovered (data_size+parity_count <= 256,
+    no prime condition). parity i = sum_j C[i][j] * data j, C[i][j] = 1 / (i ^ (parity_count + j)).
+
+    the packets are StreamData<T, 1, H> (a parity packet is as large as an item),
+    and the header counts a group of data_size+parity_count packets.
+    */
+    template<int data_size, int parity_count>
+    struct CauchyMatrix{
+        std::array<std::array<uint8_t, data_size>, parity_count> c;
+
+        CauchyMatrix(){
+            for (int i=0; i<parity_count; i++){
+                for (int j=0; j<data_size; j++)
+                    c[i][j] = gf256::inv(static_cast<uint8_t>(i ^ (parity_count + j)));
+            }
+        }
+
+        static const CauchyMatrix& get(){
+            static const CauchyMatrix m;
+            return m;
+        }
+    };
+
+    template<class T, int data_size, int parity_count = 2, class H = Header>
+    class RsEncodeBuffer{
+        static_assert(data_size >= 1 && parity_count >= 1, "data_size and parity_count must be >= 1.");
+        static_assert(data_size + parity_count <= 256, "data_size + parity_count must be <= 256.");
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        static constexpr int group_size = data_size + parity_count;
+        static constexpr int header_n = group_size - 2;     // the header layouts count header_n+2 packets
+        using Packet = StreamData<T, 1, H>;
+        using Row = std::array<uint8_t, sizeof(T)>;
+
+        std::array<Row, parity_count> m_parity;     // running parity of the current group
+        int m_count;                                // items of the current group
+        RingBuffer<Packet, group_size> m_outBuf;
+        H m_header;
+
+    public:
+        RsEncodeBuffer() : m_parity{}, m_count(0), m_header{}{}
+
+        void set_lane(uint8_t lane){
+            m_header.lane = lane;
+        }
+
+        Status enq(const T &item){
+            const size_t needed = (m_count == data_size-1) ? 1 + parity_count : 1;
+            if (m_outBuf.free() < needed)
+                return Status::BUFFER_FULL;
+
+            Packet& sd = push_header();
+            memcpy(sd.data, &item, sizeof(T));
+            const auto& matrix = CauchyMatrix<data_size, parity_count>::get();
+            for (int i=0; i<parity_count; i++)
+                gf256::mul_acc(m_parity[i].data(), sd.data, matrix.c[i][m_count], sizeof(T));
+            m_count++;
+
+            if (m_count == data_size){
+                for (int i=0; i<parity_count; i++)
+                    memcpy(push_header().data, m_parity[i].data(), sizeof(T));
+                m_parity = {};
+                m_count = 0;
+                return Status::OK_PARITY_GENERATED;
+            }
+            return Status::OK;
+        }
+
+        Status deq(Packet* psd){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            *psd = m_outBuf.front();
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        const Packet* peek() const{
+            if (m_outBuf.empty())
+                return nullptr;
+            return &m_outBuf.front();
+        }
+
+        Status pop(){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        // drop the current group and start a new epoch
+        void reset(){
+            m_parity = {};
+            m_count = 0;
+            m_outBuf.clear();
+            H header {};
+            header.epoch = m_header.epoch + 1;
+            header.lane = m_header.lane;
+            m_header = header;
+        }
+
+        size_t count(){
+            return m_outBuf.size();
+        }
+
+    private:
+        inline Packet& push_header(){
+            Packet& sd = m_outBuf.push_back();
+            sd.header = m_header;
+            m_header.template advance<header_n>();
+            return sd;
+        }
+    };
+
+    /*
+    decoder of RsEncodeBuffer. items are output in order; a group is decoded as
+    soon as data_size of its packets arrived, and given up (only the received data
+    is output, Status::LOST for the rest) when a packet of the group reorder_groups
+    ahead arrives. (the window is ReorderWindow, as in DecodeBuffer)
+    */
+    template<class T, int data_size, int parity_count = 2, int reorder_groups = 2, class H = Header>
+    class RsDecodeBuffer : public ReorderWindow<RsDecodeBuffer<T, data_size, parity_count, reorder_groups, H>,
+                                                std::array<WindowGroup<std::array<bool, data_size+parity_count>>, reorder_groups>,
+                                                std::array<uint8_t, sizeof(T)>, data_size*(reorder_groups+1)>{
+        static_assert(data_size >= 1 && parity_count >= 1, "data_size and parity_count must be >= 1.");
+        static_assert(data_size + parity_count <= 256, "data_size + parity_count must be <= 256.");
+        static_assert(reorder_groups >= 1, "reorder_groups must be >= 1.");
+        static constexpr int group_size = data_size + parity_count;
+        static constexpr int header_n = group_size - 2;
+        static_assert(reorder_groups < H::template groups<header_n>()/2, "reorder_groups is too large for the header.");
+        using Packet = StreamData<T, 1, H>;
+        using Row = std::array<uint8_t, sizeof(T)>;
+        using Window = ReorderWindow<RsDecodeBuffer, std::array<WindowGroup<std::array<bool, group_size>>, reorder_groups>,
+                                     Row, data_size*(reorder_groups+1)>;
+        friend Window;
+        using typename Window::Group;
+        using Window::m_window;
+        using Window::m_outBuf;
+        using Window::m_outDropped;
+        std::array<std::array<Row, group_size>, reorder_groups> m_slots;   // packets of m_window[i]
+        std::array<Row, parity_count> m_syndrome;
+
+    public:
+        RsDecodeBuffer() : m_slots{} {}
+
+        Status enq(const Packet &sd){
+            const size_t dropped = m_outDropped;
+            const int pos = sd.header.template position<header_n>();
+            if (pos < 0 || pos >= group_size)
+                return Status::INVALID_ARGUMENT;
+
+            const int64_t number = this->admit(sd.header.epoch, sd.header.template group<header_n>(),
+                                               [&](int64_t base){ return sd.header.template distance<header_n>(base); });
+            if (number < 0) // old epoch, or closed group
+                return Status::OK;
+
+            Group& g = this->group_of(number);
+            if (not g.used)
+                this->open(g, number);
+            if (g.received[pos] || g.decoded) // duplicated, or not needed
+                return Status::OK;
+
+            memcpy(slots(g)[pos].data(), sd.data, sizeof(T));
+            g.received[pos] = true;
+            g.received_cnt++;
+            if (g.received_cnt >= data_size)
+                decode(g);
+            this->deliver();
+
+            if (m_outDropped != dropped)
+                return Status::BUFFER_FULL;
+            return Status::OK;
+        }
+
+        // given up items are skipped
+        Status deq(T *p){
+            if (not this->skip_gaps())
+                return Status::NO_ELEMENT;
+            memcpy(p, m_outBuf.front().item.data(), sizeof(T));
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        // Status::LOST: items [info->index, info->index + info->lost) are given up. (*p is not written)
+        Status deq(T *p, ItemInfo *info){
+            const Status status = this->front(info);
+            if (status != Status::OK)
+                return status;
+            memcpy(p, m_outBuf.front().item.data(), sizeof(T));
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+    private:
+        static constexpr int group_items(){
+            return data_size;
+        }
+
+        inline void write(Row& item, const Group& g, int pos, bool){
+            item = slots(g)[pos];
+        }
+
+        inline std::array<Row, group_size>& slots(const Group& g){
+            return m_slots[&g - m_window.data()];
+        }
+
+        // lost data = C_E^-1 * (received parity - C_known * received data), from parity rows R
+        inline void decode(Group& g){
+            std::array<int, parity_count> lost;
+            int e = 0;
+            for (int j=0; j<data_size; j++){
+                if (not g.received[j])
+                    lost[e++] = j;
+            }
+            g.decoded = true;
+            if (e == 0)
+                return;
+
+            auto& slot = slots(g);
+            std::array<int, parity_count> rows;
+            for (int i=0, r=0; r<e; i++){
+                if (g.received[data_size+i])
+                    rows[r++] = i;
+            }
+            const auto& matrix = CauchyMatrix<data_size, parity_count>::get();
+            for (int r=0; r<e; r++){
+                Row& s = m_syndrome[r];
+                s = slot[data_size+rows[r]];
+                for (int j=0; j<data_size; j++){
+                    if (g.received[j])
+                        gf256::mul_acc(s.data(), slot[j].data(), matrix.c[rows[r]][j], sizeof(T));
+                }
+            }
+            std::array<uint8_t, parity_count*parity_count> a;
+            for (int r=0; r<e; r++){
+                for (int k=0; k<e; k++)
+                    a[r*e + k] = matrix.c[rows[r]][lost[k]];
+            }
+            gf256::invert<parity_count>(a.data(), e); // a square submatrix of a Cauchy matrix is regular
+            for (int k=0; k<e; k++){
+                Row& d = slot[lost[k]];
+                d = {};
+                for (int r=0; r<e; r++)
+                    gf256::mul_acc(d.data(), m_syndrome[r].data(), a[k*e + r], sizeof(T));
+            }
+        }
+    };
+}
@@ -0,0 +1,438 @@
+#pragma once
+#include "RPPP.hpp"
+#include <vector>
+
+namespace rppp{
+
+    /*
+    runtime sized codec for variable length messages
+
+    the group size (parity_size) and the largest message (max_payload) are given
+    to the constructor, and the buffers are allocated there once.
+
+    packet = VarHeader + payload
+        data   : the message itself (VarHeader::length bytes, no padding)
+        P, Q   : padded_size(parity_size) blocks of the group's block size
+
+    parity is computed over the columns [length(2 bytes) | message | zeros],
+    padded to the longest message of the group, so a recovered message also
+    gets its length back. short groups send short parity packets. any
+    parity_size works as in EncodeBuffer: the geometry has padded_size(parity_size)
+    columns, and the virtual zero columns are neither stored nor sent.
+    */
+    struct VarHeader{
+        Header header;
+        uint16_t length;    // payload bytes
+    };
+    static_assert(sizeof(VarHeader) == 6, "VarHeader must be packed.");
+
+    // 2 <= parity_size < 256
+    inline bool valid_parity_size(int parity_size){
+        return parity_size >= 2 && parity_size < 256;
+    }
+
+    class VarEncodeBuffer{
+        int m_n;                        // parity_size (0: invalid)
+        int m_padded;                   // columns of the geometry (padded_size(parity_size))
+        size_t m_maxPayload;
+        size_t m_columnBytes;           // multi_ceil(2 + max_payload, m_padded)
+        size_t m_packetBytes;           // sizeof(VarHeader) + m_columnBytes
+        std::vector<uint8_t> m_group;   // columns of the current group
+        std::vector<uint8_t> m_slots;   // Q accumulation (see pq::accumulate_q)
+        size_t m_longest;               // longest column (length + message) of the current group
+        int m_count;                    // items of the current group
+        std::vector<uint8_t> m_out;     // a group (data + P + Q)
+        size_t m_outHead;
+        size_t m_outSize;
+        seq_id_t m_seqId;
+        uint8_t m_epoch;
+
+    public:
+        // check valid() for the parity_size and max_payload
+        VarEncodeBuffer(int parity_size, size_t max_payload) :
+            m_n(0), m_padded(0), m_maxPayload(max_payload), m_columnBytes(0), m_packetBytes(0),
+            m_longest(0), m_count(0), m_outHead(0), m_outSize(0), m_seqId(0), m_epoch(0)
+        {
+            if (not valid_parity_size(parity_size))
+                return;
+            m_padded = padded_size(parity_size);
+            m_columnBytes = multi_ceil(2 + max_payload, m_padded);
+            if (m_columnBytes > std::numeric_limits<uint16_t>::max())
+                return;
+            m_n = parity_size;
+            m_packetBytes = sizeof(VarHeader) + m_columnBytes;
+            m_group.resize(m_n * m_columnBytes);
+            m_slots.resize((m_padded+1) * (m_columnBytes/m_padded));
+            m_out.resize((m_n+2) * m_packetBytes);
+        }
+
+        bool valid() const{
+            return m_n != 0;
+        }
+        int parity_size() const{
+            return m_n;
+        }
+        size_t max_payload() const{
+            return m_maxPayload;
+        }
+        // the largest packet
+        size_t packet_capacity() const{
+            return m_packetBytes;
+        }
+
+        Status enq(const void *data, size_t len){
+            if (not valid() || len > m_maxPayload)
+                return Status::INVALID_ARGUMENT;
+            // the last item of a group also emits P and Q
+            if (m_n+2 - m_outSize < ((m_count == m_n-1) ? 3u : 1u))
+                return Status::BUFFER_FULL;
+
+            uint8_t *column = &m_group[m_count * m_columnBytes];
+            const uint16_t length = static_cast<uint16_t>(len);
+            memcpy(column, &length, 2);
+            memcpy(column + 2, data, len);
+            m_longest = std::max(m_longest, 2 + len);
+            memcpy(push_packet(length), data, len);
+            m_count++;
+
+            if (m_count == m_n){
+                encode_parity();
+                m_count = 0;
+                m_longest = 0;
+                return Status::OK_PARITY_GENERATED;
+            }
+            return Status::OK;
+        }
+
+        // front packet (header + payload) without copy. (empty if none)
+        // valid until the next pop(), enq() or reset().
+        span<const uint8_t> peek() const{
+            if (m_outSize == 0)
+                return {};
+            const uint8_t *packet = &m_out[m_outHead * m_packetBytes];
+            VarHeader header;
+            memcpy(&header, packet, sizeof(header));
+            return {packet, sizeof(VarHeader) + header.length};
+        }
+
+        Status pop(){
+            if (m_outSize == 0)
+                return Status::NO_ELEMENT;
+            m_outHead = (m_outHead+1) % (m_n+2);
+            m_outSize--;
+            return Status::OK;
+        }
+
+        // copy the front packet to p (packet_capacity() bytes), and its size to len
+        Status deq(uint8_t *p, size_t *len){
+            span<const uint8_t> packet = peek();
+            if (packet.empty())
+                return Status::NO_ELEMENT;
+            memcpy(p, packet.data(), packet.size());
+            *len = packet.size();
+            return pop();
+        }
+
+        void reset(){
+            m_count = 0;
+            m_longest = 0;
+            m_outHead = 0;
+            m_outSize = 0;
+            m_seqId = 0;
+            m_epoch++; // the decoder restarts at the new epoch
+        }
+
+        size_t count() const{
+            return m_outSize;
+        }
+
+    private:
+        // append a packet and return its payload
+        inline uint8_t* push_packet(uint16_t length){
+            uint8_t *packet = &m_out[(m_outHead + m_outSize) % (m_n+2) * m_packetBytes];
+            m_outSize++;
+            VarHeader header;
+            header.header.seq_id = m_seqId;
+            header.header.epoch = m_epoch;
+            header.header.lane = 0;
+            header.length = length;
+            memcpy(packet, &header, sizeof(header));
+
+            m_seqId++;
+            if (m_seqId == seq_id_wrap(m_n))
+                m_seqId = 0;
+            return packet + sizeof(VarHeader);
+        }
+
+        inline void encode_parity(){
+            const size_t block = (m_longest + m_padded-1) / m_padded;
+            const size_t bytes = block * m_padded;
+            std::array<const uint8_t*, 256> src;
+
+            // zero padding up to the longest message
+            for (int c=0; c<m_n; c++){
+                uint8_t *column = &m_group[c * m_columnBytes];
+                uint16_t length;
+                memcpy(&length, column, 2);
+                memset(column + 2 + length, 0, bytes - 2 - length);
+            }
+
+            // P parity
+            uint8_t *p = push_packet(static_cast<uint16_t>(bytes));
+            for (int c=0; c<m_n; c++)
+                src[c] = &m_group[c * m_columnBytes];
+            memset(p, 0, bytes);
+            simd::xor_acc(p, src.data(), m_n, bytes);
+
+            // Q parity: block d = xor of the blocks (c, r) on the diagonal (c-r)%(m_padded+1) == d
+            // (P is the column m_padded of the geometry)
+            memset(m_slots.data(), 0, (m_padded+1) * block);
+            for (int c=0; c<m_n; c++)
+                pq::accumulate_q(m_slots.data(), m_padded, c, &m_group[c * m_columnBytes], block);
+            pq::accumulate_q(m_slots.data(), m_padded, m_padded, p, block);
+            uint8_t *q = push_packet(static_cast<uint16_t>(bytes));
+            for (int d=0; d<m_padded; d++)
+                memcpy(q + d*block, &m_slots[(m_padded-d) * block], block);
+        }
+    };
+
+    // group of VarDecodeBuffer
+    struct VarGroup : WindowGroup<std::vector<bool>>{
+        std::vector<uint8_t> columns;   // data, P, Q (column bytes each)
+        size_t block;                   // block bytes of the group (0: no parity received)
+    };
+
+    /*
+    decoder of VarEncodeBuffer. (the window is ReorderWindow, as in DecodeBuffer. IN_ORDER delivery)
+    reorder_groups: number of parity groups in flight.
+    an output item is the column [length | message] of its data.
+    */
+    class VarDecodeBuffer : public ReorderWindow<VarDecodeBuffer, std::vector<VarGroup>, std::vector<uint8_t>, 0>{
+        using Window = ReorderWindow<VarDecodeBuffer, std::vector<VarGroup>, std::vector<uint8_t>, 0>;
+        friend Window;
+        int m_n;                        // parity_size (0: invalid)
+        int m_padded;                   // columns of the geometry (padded_size(parity_size))
+        size_t m_maxPayload;
+        size_t m_columnBytes;
+        std::vector<int16_t> m_schedule; // see pq::fill_schedule
+        int64_t m_groupNum;             // groups in seq_id space
+
+    public:
+        // check valid() for the parity_size and max_payload
+        VarDecodeBuffer(int parity_size, size_t max_payload, int reorder_groups = 2) :
+            m_n(0), m_padded(0), m_maxPayload(max_payload), m_columnBytes(0), m_groupNum(0)
+        {
+            if (not valid_parity_size(parity_size) || reorder_groups < 1)
+                return;
+            m_padded = padded_size(parity_size);
+            m_columnBytes = multi_ceil(2 + max_payload, m_padded);
+            m_groupNum = seq_id_wrap(parity_size)/(parity_size+2);
+            if (m_columnBytes > std::numeric_limits<uint16_t>::max() || reorder_groups >= m_groupNum/2)
+                return;
+            m_n = parity_size;
+            m_schedule.resize((m_padded+1) * (m_padded+1));
+            pq::fill_schedule(m_padded, m_schedule.data());
+            m_window.resize(reorder_groups);
+            for (auto& g : m_window){
+                g.columns.resize((m_n+2) * m_columnBytes);
+                g.received.resize(m_n+2);
+                g.output.resize(m_n+2);
+                g.used = false;
+            }
+            // the whole window + a group
+            m_outBuf.resize(m_n * (reorder_groups+1), Output{std::vector<uint8_t>(2 + m_maxPayload), {}});
+        }
+
+        bool valid() const{
+            return m_n != 0;
+        }
+        int parity_size() const{
+            return m_n;
+        }
+        size_t max_payload() const{
+            return m_maxPayload;
+        }
+
+        // Status::INVALID_ARGUMENT: the packet is broken (ignored)
+        Status enq(const uint8_t *packet, size_t len){
+            VarHeader header;
+            if (not valid() || len < sizeof(header))
+                return Status::INVALID_ARGUMENT;
+            memcpy(&header, packet, sizeof(header));
+            if (sizeof(header) + header.length > len)
+                return Status::INVALID_ARGUMENT;
+            const uint8_t *payload = packet + sizeof(header);
+            const int64_t group = header.header.seq_id/(m_n+2);
+            const int pos = header.header.seq_id%(m_n+2);
+            if (group >= m_groupNum)
+                return Status::INVALID_ARGUMENT;
+            if (pos < m_n ? header.length > m_maxPayload
+                          : header.length == 0 || header.length % m_padded || header.length > m_columnBytes)
+                return Status::INVALID_ARGUMENT;
+
+            const size_t dropped = m_outDropped;
+            // distance from the oldest group (seq_id wraps around)
+            const int64_t number = admit(header.header.epoch, group, [&](int64_t base){
+                int64_t diff = (group - base%m_groupNum + m_groupNum)%m_groupNum;
+                if (diff >= m_groupNum/2)
+                    diff -= m_groupNum;
+                return diff;
+            });
+            if (number < 0)
+                return Status::OK;
+
+            Group& g = group_of(number);
+            if (not g.used)
+                open(g, number);
+            if (g.received[pos] || (g.decoded && pos < m_n)){ // duplicated
+                m_stats.duplicates.add();
+                return Status::OK;
+            }
+
+            uint8_t *column = column_of(g, pos);
+            if (pos < m_n){
+                memcpy(column, &header.length, 2);
+                memcpy(column + 2, payload, header.length);
+            }
+            else{
+                const size_t block = header.length / m_padded;
+                if (g.block && g.block != block)
+                    return Status::INVALID_ARGUMENT;
+                g.block = block;
+                memcpy(column, payload, header.length);
+            }
+            g.received[pos] = true;
+            g.received_cnt++;
+            m_stats.packets.add();
+            if (not g.decoded)
+                decode(g);
+            deliver();
+
+            // the output was full and some items were discarded
+            if (m_outDropped != dropped)
+                return Status::BUFFER_FULL;
+            return Status::OK;
+        }
+
+        // given up items are skipped. p needs max_payload() bytes.
+        Status deq(uint8_t *p, size_t *len){
+            if (not skip_gaps())
+                return Status::NO_ELEMENT;
+            pop_item(p, len);
+            return Status::OK;
+        }
+
+        // Status::LOST: items [info->index, info->index + info->lost) are given up. (*p is not written)
+        Status deq(uint8_t *p, size_t *len, ItemInfo *info){
+            const Status status = front(info);
+            if (status != Status::OK)
+                return status;
+            pop_item(p, len);
+            return Status::OK;
+        }
+
+        // counters (zero without RPPP_STATS). safe to call from another thread.
+        stats::DecodeStats::Snapshot stats() const{
+            return m_stats.snapshot();
+        }
+
+    private:
+        int group_items() const{
+            return m_n;
+        }
+
+        inline uint8_t* column_of(Group& g, int c){
+            return &g.columns[c * m_columnBytes];
+        }
+        // column of the packet position c in the geometry
+        inline int geometry(int c){
+            return (c == m_n) ? m_padded : c;
+        }
+        inline uint16_t length_of(Group& g, int c){
+            uint16_t length;
+            memcpy(&length, column_of(g, c), 2);
+            return length;
+        }
+
+        // the front item (not a gap) to p
+        inline void pop_item(uint8_t *p, size_t *len){
+            const std::vector<uint8_t>& item = m_outBuf.front().item;
+            uint16_t length;
+            memcpy(&length, item.data(), 2);
+            memcpy(p, item.data() + 2, length);
+            *len = length;
+            m_outBuf.pop();
+        }
+
+        // a length broken by a wrong parity gives up the item (see ReorderWindow)
+        inline void output(Group& g, int pos, bool recovered){
+            const uint16_t length = length_of(g, pos);
+            if (length > m_maxPayload || (recovered && 2u + length > g.block*m_padded))
+                output_lost(g, pos);
+            else
+                Window::output(g, pos, recovered);
+        }
+
+        // item pos of the group (see ReorderWindow)
+        inline void write(std::vector<uint8_t>& item, Group& g, int pos, bool){
+            memcpy(item.data(), column_of(g, pos), 2 + length_of(g, pos));
+        }
+
+        inline void open(Group& g, int64_t number){
+            Window::open(g, number);
+            g.block = 0;
+        }
+
+        // restore the lost data when parity_size packets (and the block size) are known
+        inline void decode(Group& g){
+            int data_cnt = 0;
+            for (int c=0; c<m_n; c++)
+                data_cnt += g.received[c];
+            if (data_cnt == m_n){
+                m_stats.groups_clean.add(); // all data received
+                g.decoded = true;
+                return;
+            }
+            if (g.received_cnt < m_n || g.block == 0)
+                return;
+
+            // zero padding of the received data up to the block size of the group
+            const size_t bytes = g.block * m_padded;
+            for (int c=0; c<m_n; c++){
+                if (not g.received[c])
+                    continue;
+                const size_t used = 2 + length_of(g, c);
+                if (used > bytes) // longer than the parity
+                    return;
+                memset(column_of(g, c) + used, 0, bytes - used);
+            }
+
+            // lost columns of data and P (parity_size received, so at most 2)
+            std::array<int, 2> lost;
+            int lost_num = 0;
+            for (int c=0; c<m_n+1 && lost_num<2; c++){
+                if (not g.received[c])
+                    lost[lost_num++] = c;
+            }
+
+            // P is the column m_padded of the geometry
+            const pq::Columns cols {column_of(g, 0), m_columnBytes, column_of(g, m_n), column_of(g, m_n+1), g.block, m_padded, m_n};
+            if (lost_num == 1)
+            {
+                // calculate from Horizonal parity
+                pq::recover_column<255>(cols, geometry(lost[0]));
+                m_stats.groups_p.add();
+            }
+            else if (lost_num == 2)
+            {
+                // calculate from Diagonal & Horizonal parity
+                m_stats.groups_pq.add();
+                const int a = geometry(lost[0]);
+                const int b = geometry(lost[1]);
+                const int m = m_schedule[(b-a)*(m_padded+1) + (a+1)%(m_padded+1)];
+                pq::recover_pair<255>(cols, a, b, m, 0, g.block);
+            }
+            g.decoded = true;
+        }
+    };
+}
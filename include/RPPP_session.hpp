@@ -0,0 +1,246 @@
+#pragma once
+#include "RPPP.hpp"
+#include <vector>
+#include <memory>
+#include <new>
+
+namespace rppp{
+
+    /*
+    many concurrent flows (a server with a session per player)
+
+    the sessions live in slabs of `slab_sessions` cache aligned slots, which are
+    allocated as the session count grows and reused after close(). a flow id is
+    found by an open addressing hash table of slot indexes, so routing a packet
+    is a probe of a flat array and a pointer to a slab, without allocations.
+
+        SessionManager<Input, 10> sessions;
+        sessions.enq_batch(datagrams);          // received packets of mixed flows
+        sessions.for_each([](SessionManager<Input, 10>::Session& s){
+            while (s.decoder.deq(&item) == Status::OK) ...
+        });
+    */
+    template<class T, int parity_size, int reorder_groups = 2, class H = Header>
+    class SessionManager{
+    public:
+        using flow_id_t = uint64_t;
+        using Data = StreamData<T, parity_size, H>;
+
+        struct alignas(64) Session{
+            EncodeBuffer<T, parity_size, H> encoder;
+            DecodeBuffer<T, parity_size, reorder_groups, H> decoder;
+            flow_id_t flow = 0;
+            bool used = false;
+        };
+
+        // a received packet of a flow
+        struct Datagram{
+            flow_id_t flow;
+            const Data* data;
+        };
+
+    private:
+        static constexpr size_t slab_sessions = 64;
+        static constexpr size_t route_batch = 16;  // sessions prefetched ahead in enq_batch()
+        static constexpr uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+        struct Entry{
+            flow_id_t flow;
+            uint32_t index;     // empty_slot: unused
+        };
+        std::vector<std::unique_ptr<Session[]>> m_slabs;
+        std::vector<uint32_t> m_free;       // closed slots
+        std::vector<Entry> m_table;         // power of 2, at most half full
+        size_t m_size;
+        size_t m_maxSessions;
+        bool m_autoOpen;
+        size_t m_unrouted;
+
+    public:
+        // max_sessions: open() fails beyond it (0: no limit)
+        explicit SessionManager(size_t max_sessions = 0) :
+            m_table(16, Entry{0, empty_slot}), m_size(0),
+            m_maxSessions(max_sessions), m_autoOpen(true), m_unrouted(0)
+        {}
+
+        SessionManager(const SessionManager&) = delete;
+        SessionManager& operator=(const SessionManager&) = delete;
+
+        // the session of the flow. a new one is opened if needed (nullptr: max_sessions)
+        Session* open(flow_id_t flow){
+            size_t i = probe(flow);
+            if (m_table[i].index != empty_slot)
+                return &slot(m_table[i].index);
+            if (m_maxSessions && m_size >= m_maxSessions)
+                return nullptr;
+            if (2*(m_size+1) > m_table.size()){
+                grow();
+                i = probe(flow);
+            }
+
+            if (m_free.empty())
+                add_slab();
+            const uint32_t index = m_free.back();
+            m_free.pop_back();
+            Session& s = slot(index);
+            s.~Session();
+            new (&s) Session();
+            s.flow = flow;
+            s.used = true;
+            m_table[i] = {flow, index};
+            m_size++;
+            return &s;
+        }
+
+        // nullptr if the flow has no session
+        Session* find(flow_id_t flow){
+            const uint32_t index = m_table[probe(flow)].index;
+            return (index == empty_slot) ? nullptr : &slot(index);
+        }
+
+        Status close(flow_id_t flow){
+            size_t i = probe(flow);
+            if (m_table[i].index == empty_slot)
+                return Status::NO_ELEMENT;
+            slot(m_table[i].index).used = false;
+            m_free.push_back(m_table[i].index);
+            m_size--;
+
+            // backward shift deletion (no tombstones)
+            const size_t mask = m_table.size()-1;
+            for (size_t j = (i+1)&mask; m_table[j].index != empty_slot; j = (j+1)&mask){
+                const size_t home = hash(m_table[j].flow)&mask;
+                if (((j - home)&mask) >= ((j - i)&mask)){
+                    m_table[i] = m_table[j];
+                    i = j;
+                }
+            }
+            m_table[i].index = empty_slot;
+            return Status::OK;
+        }
+
+        // packets of unknown flows open a session (default), or are not routed
+        void set_auto_open(bool auto_open){
+            m_autoOpen = auto_open;
+        }
+
+        // route the packets to the decoders of their flows. returns the number of routed packets
+        size_t enq_batch(span<const Datagram> datagrams){
+            size_t routed = 0;
+            Session* batch[route_batch];
+            for (size_t first=0; first<datagrams.size(); first+=route_batch){
+                const size_t num = std::min(route_batch, datagrams.size()-first);
+                // look up the flows first, so the sessions are loaded in parallel
+                for (size_t i=0; i<num; i++){
+                    batch[i] = route(datagrams[first+i].flow);
+                    if (batch[i])
+                        prefetch(batch[i]);
+                }
+                for (size_t i=0; i<num; i++){
+                    if (batch[i] == nullptr)
+                        continue;
+                    batch[i]->decoder.enq(*datagrams[first+i].data);
+                    routed++;
+                }
+            }
+            return routed;
+        }
+
+        // f(Session&) for every open session
+        template<class F>
+        void for_each(F&& f){
+            for (auto& slab : m_slabs){
+                for (size_t i=0; i<slab_sessions; i++){
+                    if (slab[i].used)
+                        f(slab[i]);
+                }
+            }
+        }
+
+        // the session of the flow, opened if set_auto_open() (nullptr: not routed)
+        Session* route(flow_id_t flow){
+            Session* s = find(flow);
+            if (s == nullptr && m_autoOpen)
+                s = open(flow);
+            if (s == nullptr)
+                m_unrouted++;
+            return s;
+        }
+
+        // slot indexes [0, slots()) for a parallel walk of the sessions. at() is nullptr for a free slot
+        size_t slots() const{
+            return m_slabs.size()*slab_sessions;
+        }
+        Session* at(size_t index){
+            Session& s = m_slabs[index/slab_sessions][index%slab_sessions];
+            return s.used ? &s : nullptr;
+        }
+
+        // open sessions
+        size_t size() const{
+            return m_size;
+        }
+
+        // packets of unknown flows (or beyond max_sessions)
+        size_t unrouted() const{
+            return m_unrouted;
+        }
+
+        // bytes of a session, and of all sessions including free slots and the table
+        static constexpr size_t session_bytes(){
+            return sizeof(Session);
+        }
+        size_t memory_bytes() const{
+            return m_slabs.size()*slab_sessions*sizeof(Session) + m_table.capacity()*sizeof(Entry)
+                + m_free.capacity()*sizeof(uint32_t) + m_slabs.capacity()*sizeof(m_slabs[0]);
+        }
+        size_t memory_per_session() const{
+            return m_size ? memory_bytes()/m_size : 0;
+        }
+
+    private:
+        // flow ids are often sequential or addresses: mix the bits (splitmix64)
+        static inline uint64_t hash(flow_id_t flow){
+            uint64_t x = flow + 0x9e3779b97f4a7c15ull;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+
+        // the entry of the flow, or the empty entry where it would be
+        inline size_t probe(flow_id_t flow) const{
+            const size_t mask = m_table.size()-1;
+            size_t i = hash(flow)&mask;
+            while (m_table[i].index != empty_slot && m_table[i].flow != flow)
+                i = (i+1)&mask;
+            return i;
+        }
+
+        inline Session& slot(uint32_t index){
+            return m_slabs[index/slab_sessions][index%slab_sessions];
+        }
+
+        static inline void prefetch(const Session* s){
+        #if defined(__GNUC__)
+            __builtin_prefetch(&s->decoder);
+        #else
+            (void)s;
+        #endif
+        }
+
+        void grow(){
+            std::vector<Entry> old(m_table.size()*2, Entry{0, empty_slot});
+            old.swap(m_table);
+            for (const Entry& e : old){
+                if (e.index != empty_slot)
+                    m_table[probe(e.flow)] = e;
+            }
+        }
+
+        void add_slab(){
+            const uint32_t first = static_cast<uint32_t>(m_slabs.size()*slab_sessions);
+            m_slabs.emplace_back(new Session[slab_sessions]);
+            for (size_t i=slab_sessions; i>0; i--)
+                m_free.push_back(first + static_cast<uint32_t>(i-1));
+        }
+    };
+}
@@ -0,0 +1,427 @@
+#pragma once
+#include "RPPP_rs.hpp"
+
+namespace rppp{
+
+    /*
+    sliding window FEC
+
+    every item is sent as a source packet, and after every `interval` items a
+    repair packet is sent: a GF(2^8) linear combination of the last `window`
+    items. a lost item is recovered as soon as there are as many repair packets
+    covering the lost items as lost items, so the latency of a recovery is about
+    `interval` packets instead of the rest of a parity group.
+
+    with the same overhead as a parity group of parity_size items (2 packets per
+    parity_size items), interval = parity_size/2. the window is 2*interval by
+    default (every item is covered by 2 repair packets).
+    */
+    struct SlidingHeader{
+        uint32_t seq;       // source: item number in the epoch. repair: item number of the newest covered item
+        uint16_t count;     // repair: number of covered items. 0: source
+        uint8_t epoch;
+        uint8_t reserved;
+    };
+
+    // coefficient of item `seq` in the repair packet which ends at item `end` (never 0)
+    inline uint8_t sliding_coefficient(uint32_t end, uint32_t seq){
+        uint32_t x = end*0x9e3779b1u ^ seq*0x85ebca77u;
+        x ^= x >> 15;
+        x *= 0x2c1b3c6du;
+        x ^= x >> 12;
+        return static_cast<uint8_t>(1 + x%255);
+    }
+
+    template<class T, int interval, int window = 2*interval>
+    class SlidingEncodeBuffer{
+        static_assert(interval >= 1, "interval must be >= 1.");
+        static_assert(window >= interval && window <= std::numeric_limits<uint16_t>::max(), "window must be in [interval, 65535].");
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        using Packet = StreamData<T, 1, SlidingHeader>;
+        using Row = std::array<uint8_t, sizeof(T)>;
+
+        std::array<Row, window> m_history;      // indexed by seq % window
+        uint32_t m_seq;
+        uint8_t m_epoch;
+        RingBuffer<Packet, interval+1> m_outBuf;
+
+    public:
+        SlidingEncodeBuffer() : m_seq(0), m_epoch(0){}
+
+        // Status::OK_PARITY_GENERATED: a repair packet follows the item
+        Status enq(const T &item){
+            const bool repair = (m_seq+1)%interval == 0;
+            if (m_outBuf.free() < (repair ? 2u : 1u))
+                return Status::BUFFER_FULL;
+
+            Packet& sd = m_outBuf.push_back();
+            sd.header = {m_seq, 0, m_epoch, 0};
+            memcpy(sd.data, &item, sizeof(T));
+            memcpy(m_history[m_seq%window].data(), &item, sizeof(T));
+            m_seq++;
+            if (not repair)
+                return Status::OK;
+
+            const uint32_t end = m_seq-1;
+            const uint32_t count = std::min<uint32_t>(window, m_seq);
+            Packet& rp = m_outBuf.push_back();
+            rp.header = {end, static_cast<uint16_t>(count), m_epoch, 0};
+            memset(rp.data, 0, sizeof(rp.data));
+            for (uint32_t seq = end+1-count; seq != end+1; seq++)
+                gf256::mul_acc(rp.data, m_history[seq%window].data(), sliding_coefficient(end, seq), sizeof(T));
+            return Status::OK_PARITY_GENERATED;
+        }
+
+        Status deq(Packet* psd){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            *psd = m_outBuf.front();
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        // start a new epoch (the repair packets do not cover the items before)
+        void reset(){
+            m_seq = 0;
+            m_epoch++;
+            m_outBuf.clear();
+        }
+
+        size_t count(){
+            return m_outBuf.size();
+        }
+    };
+
+    /*
+    decoder of SlidingEncodeBuffer. items are output in order. a missing item
+    is given up when a packet `window + interval` items newer arrives (no repair
+    packet covers it any more, and `interval` items of reordering are waited for).
+
+    the repair packets which still have unknown items are kept as equations in
+    reduced row echelon form, and an item is recovered when its row has no other
+    unknown.
+    */
+    template<class T, int interval, int window = 2*interval>
+    class SlidingDecodeBuffer{
+        static_assert(interval >= 1, "interval must be >= 1.");
+        static_assert(window >= interval && window <= std::numeric_limits<uint16_t>::max(), "window must be in [interval, 65535].");
+        static_assert(std::is_pod<T>::value, "T must be a POD type.");
+        static constexpr int span = window + interval;              // items in flight
+        static constexpr int max_equations = span/interval + 2;
+        using Packet = StreamData<T, 1, SlidingHeader>;
+        using Row = std::array<uint8_t, sizeof(T)>;
+        struct Slot{
+            Row data;
+            uint32_t seq;
+            bool known;
+            bool recovered;
+        };
+        struct Equation{
+            std::array<uint8_t, span> coef;     // indexed by seq % span
+            Row payload;
+            uint32_t end;
+        };
+        struct Output{
+            Row data;
+            ItemInfo info;
+        };
+        std::array<Slot, span> m_slot;
+        std::array<Equation, max_equations> m_equation;
+        int m_equations;
+        uint32_t m_base;        // oldest item not output
+        uint32_t m_end;         // one past the newest item with a slot
+        uint8_t m_epoch;
+        bool m_flag_first_call;
+        RingBuffer<Output, 2*span> m_outBuf;
+        size_t m_outGaps;
+        size_t m_outDropped;
+        Row m_row;
+
+    public:
+        SlidingDecodeBuffer() :
+            m_equations(0), m_base(0), m_end(0), m_epoch(0), m_flag_first_call(true), m_outGaps(0), m_outDropped(0)
+        {}
+
+        Status enq(const Packet &sd){
+            const SlidingHeader& h = sd.header;
+            if (h.count > window)
+                return Status::INVALID_ARGUMENT;
+            const size_t dropped = m_outDropped;
+            const uint32_t lo = h.seq + 1 - std::max<uint32_t>(h.count, 1);
+
+            if (m_flag_first_call){
+                start(h.epoch, lo);
+            }
+            else if (h.epoch != m_epoch){ // for encoder's reset
+                if (static_cast<int8_t>(h.epoch - m_epoch) < 0)
+                    return Status::OK; // delayed packet of an old epoch
+                finish();
+                start(h.epoch, lo);
+            }
+            if (distance(h.seq, m_base) < 0) // all covered items are output or given up
+                return Status::OK;
+
+            extend(h.seq);
+            if (h.count == 0)
+                source(h.seq, sd.data);
+            else
+                repair(h.seq, lo, sd.data);
+            deliver();
+
+            if (m_outDropped != dropped)
+                return Status::BUFFER_FULL;
+            return Status::OK;
+        }
+
+        // given up items are skipped
+        Status deq(T *p){
+            while (not m_outBuf.empty() && m_outBuf.front().info.lost){
+                m_outBuf.pop();
+                m_outGaps--;
+            }
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            memcpy(p, m_outBuf.front().data.data(), sizeof(T));
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        // Status::LOST: items [info->index, info->index + info->lost) are given up. (*p is not written)
+        Status deq(T *p, ItemInfo *info){
+            if (m_outBuf.empty())
+                return Status::NO_ELEMENT;
+            *info = m_outBuf.front().info;
+            if (info->lost){
+                m_outBuf.pop();
+                m_outGaps--;
+                return Status::LOST;
+            }
+            memcpy(p, m_outBuf.front().data.data(), sizeof(T));
+            m_outBuf.pop();
+            return Status::OK;
+        }
+
+        void reset(){
+            m_equations = 0;
+            m_outBuf.clear();
+            m_outGaps = 0;
+            m_base = m_end = 0;
+            m_epoch = 0;
+            m_flag_first_call = true;
+        }
+
+        // give up all missing items (e.g. at the end of the stream)
+        void finish(){
+            if (not m_flag_first_call)
+                retire(m_end);
+        }
+
+        // number of items (given up items are not counted)
+        size_t count(){
+            return m_outBuf.size() - m_outGaps;
+        }
+
+    private:
+        static inline int64_t distance(uint32_t a, uint32_t b){
+            return static_cast<int32_t>(a - b);
+        }
+
+        inline Slot& slot(uint32_t seq){
+            return m_slot[seq%span];
+        }
+
+        inline void start(uint8_t epoch, uint32_t first){
+            m_equations = 0;
+            m_base = m_end = first;
+            m_epoch = epoch;
+            m_flag_first_call = false;
+        }
+
+        // give slots up to item `last`, giving up the items older than last-span
+        inline void extend(uint32_t last){
+            if (distance(last, m_end) < 0)
+                return;
+            const uint32_t base = last + 1 - span;
+            if (distance(base, m_base) > 0)
+                retire(base);
+            if (distance(m_base, m_end) > 0)
+                m_end = m_base;
+            for (; m_end != last+1; m_end++)
+                slot(m_end) = {{}, m_end, false, false};
+        }
+
+        // give up the items before `until`
+        inline void retire(uint32_t until){
+            while (m_base != until && distance(m_base, m_end) < 0){
+                if (not slot(m_base).known){
+                    output_gap(m_base, 1);
+                    drop_equations(m_base);
+                }
+                m_base++;
+                deliver();
+            }
+            if (distance(until, m_base) > 0){ // items which have never had a slot
+                output_gap(m_base, until - m_base);
+                m_base = until;
+            }
+        }
+
+        inline void source(uint32_t seq, const uint8_t *data){
+            Slot& s = slot(seq);
+            if (s.known)
+                return; // duplicated
+            memcpy(s.data.data(), data, sizeof(T));
+            s.known = true;
+            bool changed = false;
+            for (int r=0; r<m_equations; r++){
+                Equation& e = m_equation[r];
+                const uint8_t c = e.coef[seq%span];
+                if (c == 0)
+                    continue;
+                gf256::mul_acc(e.payload.data(), s.data.data(), c, sizeof(T));
+                e.coef[seq%span] = 0;
+                changed = true;
+            }
+            if (changed)
+                solve();
+        }
+
+        inline void repair(uint32_t end, uint32_t lo, const uint8_t *data){
+            // nothing to recover (no loss): skip before any arithmetic
+            bool unknown = false;
+            for (uint32_t seq = std::max<int64_t>(distance(lo, m_base), 0) + m_base; seq != end+1; seq++){
+                if (not slot(seq).known){
+                    unknown = true;
+                    break;
+                }
+            }
+            if (not unknown)
+                return;
+
+            if (m_equations == max_equations){ // drop the oldest
+                int oldest = 0;
+                for (int r=1; r<m_equations; r++){
+                    if (distance(m_equation[r].end, m_equation[oldest].end) < 0)
+                        oldest = r;
+                }
+                remove_equation(oldest);
+            }
+            Equation& e = m_equation[m_equations];
+            e.coef = {};
+            memcpy(e.payload.data(), data, sizeof(T));
+            e.end = end;
+            for (uint32_t seq = lo; seq != end+1; seq++){
+                const Slot& s = slot(seq);
+                const uint8_t c = sliding_coefficient(end, seq);
+                if (s.seq != seq || (distance(seq, m_base) < 0 && not s.known))
+                    return; // an item out of the slots or given up: not usable
+                if (s.known)
+                    gf256::mul_acc(e.payload.data(), s.data.data(), c, sizeof(T));
+                else
+                    e.coef[seq%span] = c;
+            }
+            m_equations++;
+            solve();
+        }
+
+        // dst ^= c * src
+        inline void row_acc(Equation& dst, const Equation& src, uint8_t c){
+            gf256::mul_acc(dst.coef.data(), src.coef.data(), c, span);
+            gf256::mul_acc(dst.payload.data(), src.payload.data(), c, sizeof(T));
+        }
+
+        inline void row_scale(Equation& e, uint8_t c){
+            std::array<uint8_t, span> coef {};
+            gf256::mul_acc(coef.data(), e.coef.data(), c, span);
+            e.coef = coef;
+            m_row = {};
+            gf256::mul_acc(m_row.data(), e.payload.data(), c, sizeof(T));
+            e.payload = m_row;
+        }
+
+        inline void remove_equation(int r){
+            m_equation[r] = m_equation[m_equations-1];
+            m_equations--;
+        }
+
+        // equations with a given up item can not recover the others any more
+        inline void drop_equations(uint32_t seq){
+            for (int r=m_equations-1; r>=0; r--){
+                if (m_equation[r].coef[seq%span])
+                    remove_equation(r);
+            }
+        }
+
+        // reduced row echelon form, and recover the items of rows with a single unknown
+        inline void solve(){
+            std::array<int, max_equations> pivot;
+            for (int r=0; r<m_equations; r++){
+                Equation& e = m_equation[r];
+                for (int p=0; p<r; p++){
+                    if (pivot[p] >= 0 && e.coef[pivot[p]])
+                        row_acc(e, m_equation[p], e.coef[pivot[p]]);
+                }
+                pivot[r] = -1;
+                for (int col=0; col<span; col++){
+                    if (e.coef[col]){
+                        pivot[r] = col;
+                        break;
+                    }
+                }
+                if (pivot[r] < 0)
+                    continue; // linearly dependent
+                if (e.coef[pivot[r]] != 1)
+                    row_scale(e, gf256::inv(e.coef[pivot[r]]));
+                for (int p=0; p<r; p++){
+                    if (m_equation[p].coef[pivot[r]])
+                        row_acc(m_equation[p], e, m_equation[p].coef[pivot[r]]);
+                }
+            }
+
+            for (int r=m_equations-1; r>=0; r--){
+                const Equation& e = m_equation[r];
+                int unknowns = 0;
+                for (int col=0; col<span && unknowns<2; col++)
+                    unknowns += e.coef[col] != 0;
+                if (unknowns == 1){
+                    Slot& s = m_slot[pivot[r]];
+                    s.data = e.payload;
+                    s.known = true;
+                    s.recovered = true;
+                }
+                if (unknowns <= 1){
+                    remove_equation(r);
+                    pivot[r] = pivot[m_equations];
+                }
+            }
+        }
+
+        inline void deliver(){
+            for (; m_base != m_end && slot(m_base).known; m_base++){
+                const Slot& s = slot(m_base);
+                if (m_outBuf.full()){
+                    m_outDropped++;
+                    continue;
+                }
+                Output& out = m_outBuf.push_back();
+                out.data = s.data;
+                out.info = {m_base, 0, s.recovered};
+            }
+        }
+
+        // items [index, index+num) are given up
+        inline void output_gap(uint32_t index, uint32_t num){
+            if (m_outGaps && m_outBuf.back().info.lost && m_outBuf.back().info.index + m_outBuf.back().info.lost == index){
+                m_outBuf.back().info.lost += num;
+                return;
+            }
+            if (m_outBuf.full()){
+                m_outDropped++;
+                return;
+            }
+            Output& out = m_outBuf.push_back();
+            out.info = {index, num, false};
+            m_outGaps++;
+        }
+    };
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include "RPPP.hpp"
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <cerrno>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // linux/udp.h (Linux 4.18)
+#endif
+
+namespace rppp{
+
+    /*
+    UDP transport (Linux)
+
+    UdpSender sends the packets of a parity group together when the group is
+    complete: one sendmsg() with UDP GSO (the kernel splits the buffer into
+    datagrams of sizeof(StreamData)), or one sendmmsg() when GSO is not available.
+    the data packets wait for their group, so a group of parity_size items adds up
+    to parity_size-1 items of latency. flush() sends the waiting packets at once.
+
+    UdpReceiver drains the socket with recvmmsg() into a preallocated array of
+    StreamData, which goes to DecodeBuffer::enq_batch() as is, and passes the
+    decoded items to a callback.
+
+    the sockets are created and bound by the caller. receive() does not wait with
+    MSG_DONTWAIT (the default). with other flags on a blocking socket it waits for
+    the first datagram only (MSG_WAITFORONE), not for `batch` of them.
+    */
+    template<class T, int parity_size, class H = Header>
+    class UdpSender{
+        using Data = StreamData<T, parity_size, H>;
+        static constexpr int group_packets = parity_size+2;
+        static constexpr int gso_segments = 64;         // UDP_MAX_SEGMENTS of older kernels
+        static constexpr size_t gso_bytes = 65000;      // a GSO buffer is one IP datagram
+
+        int m_fd;
+        EncodeBuffer<T, parity_size, H> m_encoder;
+        std::array<Data, group_packets> m_packets;
+        std::array<mmsghdr, group_packets> m_msgs;
+        std::array<iovec, group_packets> m_iov;
+        sockaddr_storage m_dest;
+        socklen_t m_destLen;
+        bool m_gso;
+        size_t m_sent;
+
+    public:
+        // dest: nullptr for a connected socket. gso: try UDP GSO first
+        explicit UdpSender(int fd, const sockaddr *dest = nullptr, socklen_t dest_len = 0, bool gso = true) :
+            m_fd(fd), m_msgs{}, m_iov{}, m_dest{}, m_destLen(0), m_gso(gso), m_sent(0)
+        {
+            if (dest && dest_len <= sizeof(m_dest)){
+                memcpy(&m_dest, dest, dest_len);
+                m_destLen = dest_len;
+            }
+        }
+
+        // Status::IO_ERROR: see errno. the packets of the group which are not sent
+        // (all or some of them) are dropped
+        Status send(const T &item){
+            Status status = m_encoder.enq(item);
+            if (status == Status::BUFFER_FULL)
+                return status;
+            if (status == Status::OK_PARITY_GENERATED && flush() < 0)
+                return Status::IO_ERROR;
+            return status;
+        }
+
+        // send the packets in the encoder. returns the number of packets
+        // (-1: errno, when any of them is not sent. sent() counts the others)
+        int flush(){
+            const int num = static_cast<int>(m_encoder.drain(span<Data>(m_packets.data(), m_packets.size())));
+            if (num == 0)
+                return 0;
+            const int sent = m_gso ? send_gso(num) : send_mmsg(num);
+            m_sent += sent;
+            return sent < num ? -1 : sent;
+        }
+
+        EncodeBuffer<T, parity_size, H>& encoder(){
+            return m_encoder;
+        }
+
+        // false after GSO was refused by the kernel
+        bool gso() const{
+            return m_gso;
+        }
+
+        // packets sent
+        size_t sent() const{
+            return m_sent;
+        }
+
+    private:
+        inline msghdr header(iovec *iov, size_t iov_len){
+            msghdr msg {};
+            msg.msg_name = m_destLen ? &m_dest : nullptr;
+            msg.msg_namelen = m_destLen;
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iov_len;
+            return msg;
+        }
+
+        // the number of packets sent (< num: errno)
+        int send_gso(int num){
+            constexpr int per_send = std::min<int>(gso_segments, std::max<size_t>(1, gso_bytes/sizeof(Data)));
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))];
+            int sent = 0;
+            while (sent < num){
+                const int n = std::min(per_send, num - sent);
+                iovec iov {&m_packets[sent], n*sizeof(Data)};
+                msghdr msg = header(&iov, 1);
+                if (n > 1){
+                    // the packets are contiguous: the kernel cuts them at sizeof(Data)
+                    memset(control, 0, sizeof(control));
+                    msg.msg_control = control;
+                    msg.msg_controllen = sizeof(control);
+                    cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+                    cm->cmsg_level = SOL_UDP;
+                    cm->cmsg_type = UDP_SEGMENT;
+                    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                    const uint16_t segment = static_cast<uint16_t>(sizeof(Data));
+                    memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+                }
+                if (sendmsg(m_fd, &msg, 0) < 0){
+                    if (sent == 0 && (errno == EINVAL || errno == ENOPROTOOPT || errno == EIO || errno == EOPNOTSUPP)){
+                        m_gso = false; // no GSO on this kernel / device
+                        return send_mmsg(num);
+                    }
+                    return sent;
+                }
+                sent += n;
+            }
+            return sent;
+        }
+
+        int send_mmsg(int num){
+            for (int i=0; i<num; i++){
+                m_iov[i] = {&m_packets[i], sizeof(Data)};
+                m_msgs[i].msg_hdr = header(&m_iov[i], 1);
+            }
+            int sent = 0;
+            while (sent < num){
+                const int ret = sendmmsg(m_fd, &m_msgs[sent], num - sent, 0);
+                if (ret < 0)
+                    return sent;
+                sent += ret;
+            }
+            return sent;
+        }
+    };
+
+    template<class T, int parity_size, int reorder_groups = 2, class H = Header, size_t batch = 64>
+    class UdpReceiver{
+        using Data = StreamData<T, parity_size, H>;
+        int m_fd;
+        DecodeBuffer<T, parity_size, reorder_groups, H> m_decoder;
+        std::array<Data, batch> m_packets;
+        std::array<mmsghdr, batch> m_msgs;
+        std::array<iovec, batch> m_iov;
+        T m_item;
+        size_t m_received;
+        size_t m_invalid;
+
+    public:
+        explicit UdpReceiver(int fd) : m_fd(fd), m_msgs{}, m_iov{}, m_received(0), m_invalid(0){
+            for (size_t i=0; i<batch; i++){
+                m_iov[i] = {&m_packets[i], sizeof(Data)};
+                m_msgs[i].msg_hdr.msg_iov = &m_iov[i];
+                m_msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+
+        // drain the socket into the decoder, and the decoded items into on_item(const T&)
+        // (given up items are skipped). returns the number of packets (-1: errno)
+        template<class F>
+        int receive(F&& on_item, int flags = MSG_DONTWAIT){
+            if (not (flags & MSG_DONTWAIT))
+                flags |= MSG_WAITFORONE; // a blocking socket: wait for a datagram, not for `batch`
+            int total = 0;
+            for (;;){
+                const int num = recvmmsg(m_fd, m_msgs.data(), batch, flags, nullptr);
+                if (num < 0){
+                    if (total || errno == EAGAIN || errno == EWOULDBLOCK)
+                        return total;
+                    return -1;
+                }
+                // packets of another size are dropped (truncated or foreign)
+                size_t valid = 0;
+                for (int i=0; i<num; i++){
+                    if (m_msgs[i].msg_len != sizeof(Data) || (m_msgs[i].msg_hdr.msg_flags & MSG_TRUNC)){
+                        m_invalid++;
+                        continue;
+                    }
+                    if (valid != static_cast<size_t>(i))
+                        m_packets[valid] = m_packets[i];
+                    valid++;
+                }
+                // the decoder takes packets while its output has room
+                for (size_t done=0; done<valid;){
+                    done += m_decoder.enq_batch(span<const Data>(m_packets.data()+done, valid-done));
+                    deliver(on_item);
+                }
+                m_received += valid;
+                total += num;
+                if (static_cast<size_t>(num) < batch)
+                    return total;
+                flags |= MSG_DONTWAIT; // the rest without waiting
+            }
+        }
+
+        DecodeBuffer<T, parity_size, reorder_groups, H>& decoder(){
+            return m_decoder;
+        }
+
+        // packets given to the decoder, and dropped datagrams of a wrong size
+        size_t received() const{
+            return m_received;
+        }
+        size_t invalid() const{
+            return m_invalid;
+        }
+
+    private:
+        template<class F>
+        inline void deliver(F& on_item){
+            while (m_decoder.deq(&m_item) == Status::OK)
+                on_item(static_cast<const T&>(m_item));
+        }
+    };
+}
+#endif
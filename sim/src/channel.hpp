@@ -0,0 +1,75 @@
+#pragma once
+#include <random>
+#include <cstdint>
+
+namespace sim{
+
+    enum LossModel{
+        BERNOULLI,          // independent losses
+        GILBERT_ELLIOTT,    // two state (good / bad) burst losses
+    };
+
+    struct ChannelConfig{
+        LossModel model = LossModel::BERNOULLI;
+        double loss = 0.01;         // BERNOULLI: loss rate, GILBERT_ELLIOTT: loss rate in the good state
+        double loss_bad = 0.5;      // loss rate in the bad state
+        double p_gb = 0.001;        // good -> bad per packet
+        double p_bg = 0.1;          // bad -> good per packet (mean burst = 1/p_bg packets)
+        double duplicate = 0;       // a packet arrives twice
+        double delay_ms = 20;       // one way delay
+        double jitter_ms = 0;       // uniform [0, jitter_ms) on top of the delay
+        double reorder = 0;         // a packet is held back for reorder_ms more
+        double reorder_ms = 0;
+    };
+
+    /*
+    lossy channel
+
+    transmit() draws the fate of one packet: 0 (lost), 1 or 2 (duplicated) copies
+    and the delay of each copy. reordering is the result of the jitter and the
+    held back packets.
+    */
+    class Channel{
+        ChannelConfig m_config;
+        std::mt19937_64 m_rng;
+        std::uniform_real_distribution<double> m_uniform;
+        bool m_bad;
+
+    public:
+        Channel(const ChannelConfig& config, uint64_t seed) :
+            m_config(config), m_rng(seed), m_uniform(0.0, 1.0), m_bad(false){}
+
+        // returns the number of copies, and their delays (ms) in delays[0..]
+        int transmit(double delays[2]){
+            double loss = m_config.loss;
+            if (m_config.model == LossModel::GILBERT_ELLIOTT){
+                m_bad = m_bad ? (draw() >= m_config.p_bg) : (draw() < m_config.p_gb);
+                if (m_bad)
+                    loss = m_config.loss_bad;
+            }
+            if (draw() < loss)
+                return 0;
+
+            const int copies = (draw() < m_config.duplicate) ? 2 : 1;
+            for (int i=0; i<copies; i++){
+                delays[i] = m_config.delay_ms + m_config.jitter_ms*draw();
+                if (draw() < m_config.reorder)
+                    delays[i] += m_config.reorder_ms;
+            }
+            return copies;
+        }
+
+        // long run loss rate of the model
+        double mean_loss() const{
+            if (m_config.model == LossModel::BERNOULLI)
+                return m_config.loss;
+            const double bad = m_config.p_gb / (m_config.p_gb + m_config.p_bg);
+            return (1-bad)*m_config.loss + bad*m_config.loss_bad;
+        }
+
+    private:
+        inline double draw(){
+            return m_uniform(m_rng);
+        }
+    };
+}
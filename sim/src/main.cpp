@@ -0,0 +1,364 @@
+#include "RPPP.hpp"
+#include "RPPP_sliding.hpp"
+#include "channel.hpp"
+#include <vector>
+#include <queue>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+Monte Carlo simulation of EncodeBuffer -> Channel -> DecodeBuffer
+
+items are sent every interval_ms, the packets go through the channel, and the
+decoder gets them in the order of arrival (with the simulated time). the items
+are split into trials which run on all cores.
+
+    sim --parity=4,10,30 --model=ge --loss=0.001 --loss-bad=0.5 --p-gb=0.002 --p-bg=0.2
+
+--fec=sliding runs SlidingEncodeBuffer / SlidingDecodeBuffer with the same overhead
+(a repair packet per parity_size/2 items, over a window of parity_size items)
+instead, and --fec=both runs both for each parity size to compare the latency.
+*/
+namespace {
+
+    using namespace rppp;
+
+    // a typical game state update
+    struct Item{
+        uint8_t data[32];
+    };
+
+    enum Fec{
+        BLOCK = 1,
+        SLIDING = 2,
+    };
+
+    struct Config{
+        sim::ChannelConfig channel;
+        int fec = Fec::BLOCK;       // Fec bits
+        std::vector<int> parity_sizes {2, 4, 6, 8, 10, 12, 16, 22, 30, 40, 60, 100};
+        uint64_t items = 10000000;
+        uint64_t trial_items = 100000;
+        double interval_ms = 1;
+        double deadline_ms = 0;     // DecodeBuffer::set_deadline() (0: none)
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t seed = 1;
+        const char *json = nullptr;
+    };
+
+    struct Stats{
+        uint64_t items = 0;
+        uint64_t delivered = 0;
+        uint64_t recovered = 0;
+        uint64_t packets = 0;
+        std::vector<float> latency_ms; // of the delivered items
+
+        void merge(Stats& other){
+            items += other.items;
+            delivered += other.delivered;
+            recovered += other.recovered;
+            packets += other.packets;
+            latency_ms.insert(latency_ms.end(), other.latency_ms.begin(), other.latency_ms.end());
+        }
+    };
+
+    struct Result{
+        const char *fec;
+        int parity_size;
+        double efficiency;      // items / packets
+        double residual_loss;   // items not delivered / items
+        double recovered;       // recovered items / items
+        double latency_p50_ms;
+        double latency_p99_ms;
+        double latency_p999_ms;
+        double latency_max_ms;
+    };
+
+    // parity groups of parity_size items
+    template<int parity_size>
+    struct BlockCodec{
+        static constexpr const char *name = "block";
+        static constexpr int cycle = parity_size;  // items of a whole group
+        static constexpr bool has_clock = true;
+        using Encoder = EncodeBuffer<Item, parity_size>;
+        using Decoder = DecodeBuffer<Item, parity_size>;
+        using Packet = StreamData<Item, parity_size>;
+    };
+
+    // sliding window with the overhead of a parity group of parity_size items
+    template<int parity_size>
+    struct SlidingCodec{
+        static constexpr const char *name = "sliding";
+        static constexpr int cycle = parity_size/2;
+        static constexpr bool has_clock = false;
+        using Encoder = SlidingEncodeBuffer<Item, parity_size/2, parity_size>;
+        using Decoder = SlidingDecodeBuffer<Item, parity_size/2, parity_size>;
+        using Packet = StreamData<Item, 1, SlidingHeader>;
+    };
+
+    template<class Codec>
+    struct Arrival{
+        double time;
+        uint64_t order;     // packets of the same time arrive in the order sent
+        typename Codec::Packet sd;
+
+        bool operator>(const Arrival& other) const{
+            return time > other.time || (time == other.time && order > other.order);
+        }
+    };
+
+    template<class Clock>
+    typename Clock::time_point time_point_of(double ms){
+        return typename Clock::time_point(std::chrono::duration_cast<typename Clock::duration>(std::chrono::duration<double, std::milli>(ms)));
+    }
+
+    template<class Codec>
+    void run_trial(const Config& config, uint64_t seed, Stats& stats){
+        using Decoder = typename Codec::Decoder;
+        using Clock = typename DecodeBuffer<Item, 2>::Clock;
+        sim::Channel channel(config.channel, seed);
+        typename Codec::Encoder encoder;
+        auto decoder = std::make_unique<Decoder>();
+        if constexpr (Codec::has_clock){
+            if (config.deadline_ms > 0)
+                decoder->set_deadline(std::chrono::duration_cast<typename Clock::duration>(std::chrono::duration<double, std::milli>(config.deadline_ms)));
+        }
+        std::priority_queue<Arrival<Codec>, std::vector<Arrival<Codec>>, std::greater<Arrival<Codec>>> in_flight;
+
+        Item item {};
+        ItemInfo info;
+        auto receive = [&](double now){
+            Status status;
+            while ((status = decoder->deq(&item, &info)) != Status::NO_ELEMENT){
+                if (status != Status::OK)
+                    continue;
+                stats.delivered++;
+                stats.recovered += info.recovered;
+                stats.latency_ms.push_back(static_cast<float>(now - info.index*config.interval_ms));
+            }
+        };
+        auto arrive_until = [&](double time){
+            while (not in_flight.empty() && in_flight.top().time <= time){
+                const Arrival<Codec>& a = in_flight.top();
+                const double now = a.time;
+                if constexpr (Codec::has_clock)
+                    decoder->enq(a.sd, time_point_of<Clock>(now));
+                else
+                    decoder->enq(a.sd);
+                in_flight.pop();
+                receive(now);
+            }
+        };
+
+        const uint64_t items = config.trial_items/Codec::cycle*Codec::cycle; // whole groups
+        typename Codec::Packet sd;
+        double delays[2];
+        for (uint64_t i=0; i<items; i++){
+            const double now = i*config.interval_ms;
+            arrive_until(now);
+            if constexpr (Codec::has_clock){
+                if (config.deadline_ms > 0){
+                    decoder->poll(time_point_of<Clock>(now));
+                    receive(now);
+                }
+            }
+
+            memcpy(item.data, &i, sizeof(i));
+            encoder.enq(item);
+            while (encoder.deq(&sd) == Status::OK){
+                stats.packets++;
+                const int copies = channel.transmit(delays);
+                for (int c=0; c<copies; c++)
+                    in_flight.push({now + delays[c], stats.packets, sd});
+            }
+        }
+        arrive_until(std::numeric_limits<double>::infinity());
+        stats.items += items;
+    }
+
+    template<int parity_size, class Codec>
+    Result run(const Config& config){
+        const uint64_t trials = (config.items + config.trial_items - 1)/config.trial_items;
+        std::atomic<uint64_t> next {0};
+        std::mutex mutex;
+        Stats total;
+
+        std::vector<std::thread> threads;
+        for (unsigned t=0; t<config.threads; t++){
+            threads.emplace_back([&]{
+                Stats stats;
+                for (uint64_t trial; (trial = next++) < trials;)
+                    run_trial<Codec>(config, config.seed*1000003 + trial, stats);
+                std::lock_guard<std::mutex> lock(mutex);
+                total.merge(stats);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        Result r {};
+        r.fec = Codec::name;
+        r.parity_size = parity_size;
+        r.efficiency = static_cast<double>(total.items)/total.packets;
+        r.residual_loss = 1 - static_cast<double>(total.delivered)/total.items;
+        r.recovered = static_cast<double>(total.recovered)/total.items;
+        auto& l = total.latency_ms;
+        auto at = [&](double q){
+            if (l.empty())
+                return 0.0;
+            auto it = l.begin() + std::min(l.size()-1, static_cast<size_t>(q*l.size()));
+            std::nth_element(l.begin(), it, l.end());
+            return static_cast<double>(*it);
+        };
+        r.latency_p50_ms = at(0.5);
+        r.latency_p99_ms = at(0.99);
+        r.latency_p999_ms = at(0.999);
+        r.latency_max_ms = l.empty() ? 0.0 : *std::max_element(l.begin(), l.end());
+        return r;
+    }
+
+    // parity sizes compiled in the simulator
+    template<int... parity_sizes>
+    struct ParityList{
+        template<template<int> class Codec>
+        static bool run(int parity_size, const Config& config, Result& result){
+            return ((parity_size == parity_sizes ? (result = ::run<parity_sizes, Codec<parity_sizes>>(config), true) : false) || ...);
+        }
+    };
+    using Supported = ParityList<2, 4, 6, 8, 10, 12, 16, 18, 22, 28, 30, 32, 36, 40, 60, 72, 100>;
+
+    bool parse(int argc, char **argv, Config& config){
+        for (int i=1; i<argc; i++){
+            const char *arg = argv[i];
+            const char *eq = strchr(arg, '=');
+            if (strncmp(arg, "--", 2) != 0 || eq == nullptr)
+                return false;
+            const std::string key(arg+2, eq);
+            const char *value = eq+1;
+            auto& c = config.channel;
+            if (key == "fec"){
+                if (strcmp(value, "block") == 0)
+                    config.fec = Fec::BLOCK;
+                else if (strcmp(value, "sliding") == 0)
+                    config.fec = Fec::SLIDING;
+                else if (strcmp(value, "both") == 0)
+                    config.fec = Fec::BLOCK | Fec::SLIDING;
+                else
+                    return false;
+            }
+            else if (key == "model"){
+                if (strcmp(value, "bernoulli") == 0)
+                    c.model = sim::LossModel::BERNOULLI;
+                else if (strcmp(value, "ge") == 0)
+                    c.model = sim::LossModel::GILBERT_ELLIOTT;
+                else
+                    return false;
+            }
+            else if (key == "loss")         c.loss = atof(value);
+            else if (key == "loss-bad")     c.loss_bad = atof(value);
+            else if (key == "p-gb")         c.p_gb = atof(value);
+            else if (key == "p-bg")         c.p_bg = atof(value);
+            else if (key == "duplicate")    c.duplicate = atof(value);
+            else if (key == "delay")        c.delay_ms = atof(value);
+            else if (key == "jitter")       c.jitter_ms = atof(value);
+            else if (key == "reorder")      c.reorder = atof(value);
+            else if (key == "reorder-delay") c.reorder_ms = atof(value);
+            else if (key == "items")        config.items = strtoull(value, nullptr, 10);
+            else if (key == "trial-items")  config.trial_items = strtoull(value, nullptr, 10);
+            else if (key == "interval")     config.interval_ms = atof(value);
+            else if (key == "deadline")     config.deadline_ms = atof(value);
+            else if (key == "threads")      config.threads = std::max(1, atoi(value));
+            else if (key == "seed")         config.seed = strtoull(value, nullptr, 10);
+            else if (key == "json")         config.json = value;
+            else if (key == "parity"){
+                config.parity_sizes.clear();
+                for (const char *p = value; *p;){
+                    char *end;
+                    config.parity_sizes.push_back(static_cast<int>(strtol(p, &end, 10)));
+                    if (end == p || (*end != ',' && *end != '\0'))
+                        return false;
+                    p = (*end == ',') ? end+1 : end;
+                }
+            }
+            else
+                return false;
+        }
+        return config.trial_items > 0 && config.interval_ms > 0;
+    }
+
+    void usage(){
+        fprintf(stderr,
+            "usage: sim [--key=value ...]\n"
+            "  --parity=2,4,10      parity sizes (2 4 6 8 10 12 16 18 22 28 30 32 36 40 60 72 100)\n"
+            "  --fec=block|sliding|both   parity groups, or sliding window repair at the same overhead\n"
+            "  --model=bernoulli|ge loss model (ge: Gilbert-Elliott)\n"
+            "  --loss=0.01          loss rate (ge: in the good state)\n"
+            "  --loss-bad=0.5 --p-gb=0.001 --p-bg=0.1   ge: bad state loss, good->bad, bad->good\n"
+            "  --duplicate=0        duplication rate\n"
+            "  --delay=20 --jitter=0 --reorder=0 --reorder-delay=0   ms\n"
+            "  --items=10000000 --trial-items=100000 --interval=1 (ms) --deadline=0 (ms)\n"
+            "  --threads=N --seed=1 --json=result.json\n");
+    }
+}
+
+int main(int argc, char **argv){
+    Config config;
+    if (not parse(argc, argv, config)){
+        usage();
+        return 1;
+    }
+
+    std::vector<Result> results;
+    printf("mean loss %.4f%%, %llu items, %u threads\n", 100*sim::Channel(config.channel, 0).mean_loss(),
+        static_cast<unsigned long long>(config.items), config.threads);
+    printf("%7s %7s %10s %14s %10s %10s %10s %10s %10s\n",
+        "fec", "parity", "efficiency", "residual_loss", "recovered", "p50_ms", "p99_ms", "p999_ms", "max_ms");
+    for (int parity_size : config.parity_sizes){
+        for (int fec : {Fec::BLOCK, Fec::SLIDING}){
+            if (not (config.fec & fec))
+                continue;
+            Result r;
+            const bool compiled = (fec == Fec::BLOCK) ?
+                Supported::run<BlockCodec>(parity_size, config, r) :
+                Supported::run<SlidingCodec>(parity_size, config, r);
+            if (not compiled){
+                fprintf(stderr, "parity size %d is not compiled in\n", parity_size);
+                continue;
+            }
+            printf("%7s %7d %9.2f%% %13.5f%% %9.3f%% %10.2f %10.2f %10.2f %10.2f\n",
+                r.fec, r.parity_size, 100*r.efficiency, 100*r.residual_loss, 100*r.recovered,
+                r.latency_p50_ms, r.latency_p99_ms, r.latency_p999_ms, r.latency_max_ms);
+            fflush(stdout);
+            results.push_back(r);
+        }
+    }
+
+    if (config.json){
+        FILE *f = fopen(config.json, "w");
+        if (f == nullptr){
+            perror(config.json);
+            return 1;
+        }
+        fprintf(f, "{\"mean_loss\": %g, \"items\": %llu, \"results\": [", sim::Channel(config.channel, 0).mean_loss(),
+            static_cast<unsigned long long>(config.items));
+        for (size_t i=0; i<results.size(); i++){
+            const Result& r = results[i];
+            fprintf(f, "%s\n  {\"fec\": \"%s\", \"parity_size\": %d, \"efficiency\": %g, \"residual_loss\": %g, \"recovered\": %g, "
+                "\"latency_p50_ms\": %g, \"latency_p99_ms\": %g, \"latency_p999_ms\": %g, \"latency_max_ms\": %g}",
+                i ? "," : "", r.fec, r.parity_size, r.efficiency, r.residual_loss, r.recovered,
+                r.latency_p50_ms, r.latency_p99_ms, r.latency_p999_ms, r.latency_max_ms);
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+#include "RPPP_adaptive.hpp"
+#include <vector>
+#include <random>
+
+using namespace rppp;
+
+class AdaptiveTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        int y;
+        uint8_t z;
+    };
+    using Encoder = AdaptiveEncoder<NetVar, 2, 4, 10, 30, 100>;
+    using Decoder = AdaptiveDecoder<NetVar, 2, 4, 10, 30, 100>;
+    using Packet = AdaptiveData<NetVar, 2, 4, 10, 30, 100>;
+
+    static void send(Encoder& e_buf, int x, std::vector<Packet>& pipe){
+        EXPECT_NE(e_buf.enq(NetVar{x, -x, 0}), Status::BUFFER_FULL);
+        Packet packet;
+        while (e_buf.deq(&packet) == Status::OK)
+            pipe.push_back(packet);
+    }
+};
+
+TEST_F(AdaptiveTest, level_test){
+    EXPECT_NEAR(group_loss_probability(2, 0.5), 1 - 11/16.0, 1e-12);
+    EXPECT_EQ(group_loss_probability(10, 0), 0);
+
+    Encoder e_buf;
+    EXPECT_EQ(e_buf.level_for(0.0005), 4);  // 100
+    EXPECT_EQ(e_buf.level_for(0.005), 3);   // 30
+    EXPECT_EQ(e_buf.level_for(0.01), 2);    // 10
+    EXPECT_EQ(e_buf.level_for(0.08), 0);    // 2
+    e_buf.set_target_loss(1e-2);
+    EXPECT_EQ(e_buf.level_for(0.01), 3);    // 30
+}
+
+TEST_F(AdaptiveTest, switch_test){
+    Encoder e_buf;
+    std::vector<Packet> pipe;
+    int x = 0;
+    // the switch waits for the group boundary
+    send(e_buf, x++, pipe);
+    e_buf.set_level(2);
+    send(e_buf, x++, pipe);
+    EXPECT_EQ(e_buf.parity_size(), 2);
+    send(e_buf, x++, pipe);
+    EXPECT_EQ(e_buf.parity_size(), 10);
+    for (int i=0; i<25; i++)
+        send(e_buf, x++, pipe);
+    e_buf.set_level(1);
+    for (int i=0; i<8; i++)
+        send(e_buf, x++, pipe);
+    EXPECT_EQ(e_buf.parity_size(), 4);
+
+    // only the bytes of the level are sent
+    EXPECT_EQ(pipe.front().size(), sizeof(Header) + multi_ceil(sizeof(NetVar), 2));
+    EXPECT_EQ(pipe.back().size(), sizeof(Header) + multi_ceil(sizeof(NetVar), 4));
+
+    // lose a data packet of every group, and swap the packets around the switches
+    std::vector<Packet> recv;
+    for (size_t i=0; i<pipe.size(); i++){
+        if (pipe[i].header.seq_id%(pipe[i].header.lane == 0 ? 4 : pipe[i].header.lane == 1 ? 6 : 12) == 1)
+            continue;
+        recv.push_back(pipe[i]);
+    }
+    for (size_t i=1; i<recv.size(); i++){
+        if (recv[i].header.epoch != recv[i-1].header.epoch)
+            std::swap(recv[i], recv[i-1]);
+    }
+
+    Decoder d_buf;
+    std::vector<int> out;
+    NetVar item;
+    for (auto& packet : recv){
+        d_buf.enq(packet);
+        while (d_buf.deq(&item) == Status::OK)
+            out.push_back(item.x);
+    }
+    ASSERT_EQ(out.size(), static_cast<size_t>(x));
+    for (int i=0; i<x; i++)
+        EXPECT_EQ(out[i], i);
+}
+
+TEST_F(AdaptiveTest, unused_level_test){
+    // level 0 is unused while the segment id (the epoch) goes around: 200 switches make
+    // it look older, 256 make it the same
+    Encoder e_buf;
+    Decoder d_buf;
+    std::vector<Packet> pipe;
+    std::vector<int> out;
+    NetVar item;
+    int x = 0;
+    auto run = [&](int items){
+        for (int i=0; i<items; i++)
+            send(e_buf, x++, pipe);
+        for (auto& packet : pipe){
+            d_buf.enq(packet);
+            while (d_buf.deq(&item) == Status::OK)
+                out.push_back(item.x);
+        }
+        pipe.clear();
+    };
+
+    run(40);
+    for (int switches : {200, 256}){
+        for (int i=0; i<switches; i++){
+            e_buf.set_level(1 + i%2);
+            run(20);
+            ASSERT_EQ(e_buf.level(), 1 + i%2);
+        }
+        e_buf.set_level(0);
+        run(40);
+        ASSERT_EQ(e_buf.level(), 0);
+    }
+    ASSERT_EQ(out.size(), static_cast<size_t>(x));
+    for (int i=0; i<x; i++)
+        ASSERT_EQ(out[i], i);
+}
+
+TEST_F(AdaptiveTest, drain_test){
+    // the segments 4 (8 items), 10, 2 arrive before any item is dequeued: the segment
+    // after the next finishes the first one, whose items still come out first
+    Encoder e_buf;
+    Decoder d_buf;
+    std::vector<Packet> pipe;
+    std::vector<int> out;
+    NetVar item;
+    int x = 0;
+    for (auto level_items : {std::make_pair(1, 8), std::make_pair(2, 10), std::make_pair(0, 4)}){
+        e_buf.set_level(level_items.first);
+        for (int i=0; i<level_items.second; i++)
+            send(e_buf, x++, pipe);
+        EXPECT_EQ(e_buf.level(), level_items.first);
+    }
+    for (auto& packet : pipe)
+        d_buf.enq(packet);
+    EXPECT_EQ(d_buf.count(), 8u + 10u);
+    while (d_buf.deq(&item) == Status::OK)
+        out.push_back(item.x);
+
+    // the level of the drained segment again
+    pipe.clear();
+    e_buf.set_level(1);
+    for (int i=0; i<8; i++)
+        send(e_buf, x++, pipe);
+    for (auto& packet : pipe){
+        d_buf.enq(packet);
+        while (d_buf.deq(&item) == Status::OK)
+            out.push_back(item.x);
+    }
+    ASSERT_EQ(out.size(), static_cast<size_t>(x));
+    for (int i=0; i<x; i++)
+        EXPECT_EQ(out[i], i);
+}
+
+TEST_F(AdaptiveTest, adapt_test){
+    Encoder e_buf;
+    Decoder d_buf;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    NetVar item;
+    int x = 0, last = -1;
+    size_t out = 0;
+
+    auto run = [&](double loss, int items){
+        std::vector<Packet> pipe;
+        for (int i=0; i<items; i++){
+            send(e_buf, x++, pipe);
+            for (auto& packet : pipe){
+                if (uniform(rng) >= loss)
+                    d_buf.enq(packet);
+            }
+            pipe.clear();
+            while (d_buf.deq(&item) == Status::OK){
+                EXPECT_GT(item.x, last);
+                last = item.x;
+                out++;
+            }
+            if (x % 1000 == 0)
+                e_buf.on_report(d_buf.report());
+        }
+    };
+
+    run(0.0002, 20000);
+    EXPECT_EQ(e_buf.parity_size(), 100);
+    EXPECT_EQ(d_buf.level(), 4);
+    run(0.05, 20000);
+    EXPECT_EQ(e_buf.parity_size(), 2);
+    EXPECT_EQ(d_buf.level(), 0);
+    EXPECT_NEAR(e_buf.loss(), 0.05, 0.02);
+    run(0.01, 30000);
+    EXPECT_EQ(e_buf.parity_size(), 10);
+    EXPECT_GT(out, x*0.99);
+}
+
+TEST_F(AdaptiveTest, duplicate_report_test){
+    // duplicated packets (at once and late) are not counted as received
+    Encoder e_buf;
+    Decoder d_buf;
+    e_buf.set_level(2);
+    std::vector<Packet> pipe;
+    for (int x=0; x<3000; x++)
+        send(e_buf, x, pipe);
+    uint32_t lost = 0;
+    std::vector<Packet> late;
+    for (size_t i=0; i<pipe.size(); i++){
+        if (i%20 == 7){
+            lost++;
+            continue;
+        }
+        d_buf.enq(pipe[i]);
+        if (i%3 == 0)
+            d_buf.enq(pipe[i]);
+        if (i%5 == 0)
+            late.push_back(pipe[i]);
+        if (late.size() == 8){
+            for (auto& packet : late)
+                d_buf.enq(packet);
+            late.clear();
+        }
+    }
+    const LossReport report = d_buf.report();
+    EXPECT_EQ(report.lost, lost);
+    EXPECT_EQ(report.received, pipe.size() - lost);
+}
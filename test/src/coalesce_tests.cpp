@@ -0,0 +1,188 @@
+#include "gtest/gtest.h"
+#include "RPPP_coalesce.hpp"
+#include <vector>
+#include <random>
+
+using namespace rppp;
+
+class CoalesceTest : public ::testing::Test {
+
+protected:
+    // a small item
+    struct SmallItem{
+        uint32_t id;
+        float x;
+        float y;
+    };
+    static constexpr int K = 8;
+    static constexpr int parity_size = 4;
+    using Encoder = CoalesceEncoder<SmallItem, K, parity_size>;
+    using Decoder = CoalesceDecoder<SmallItem, K, parity_size>;
+    using Item = Batch<SmallItem, K>;
+    using Packet = StreamData<Item, parity_size>;
+    using Clock = Encoder::Clock;
+
+    static SmallItem item(int i){
+        return {static_cast<uint32_t>(i), i*0.5f, -i*0.25f};
+    }
+
+    static void expect_item(const SmallItem& v, int i){
+        EXPECT_EQ(v.id, static_cast<uint32_t>(i));
+        EXPECT_EQ(v.x, i*0.5f);
+        EXPECT_EQ(v.y, -i*0.25f);
+    }
+};
+
+TEST_F(CoalesceTest, packet_rate_test){
+    // K items per data packet
+    Encoder encoder;
+    Packet sd;
+    int packets = 0;
+    for (int i=0; i<K*parity_size*10; i++){
+        encoder.enq(item(i));
+        while (encoder.deq(&sd) == Status::OK)
+            packets++;
+    }
+    EXPECT_EQ(packets, (parity_size+2)*10);
+    EXPECT_EQ(encoder.pending(), 0u);
+}
+
+TEST_F(CoalesceTest, drop_test){
+    // 2 lost packets per group: 2K lost items recovered
+    std::vector<std::pair<int, int>> pairs; // lost positions of each group
+    for (int a=0; a<parity_size+2; a++){
+        for (int b=a; b<parity_size+2; b++)
+            pairs.emplace_back(a, b);
+    }
+    const int items = K*parity_size*static_cast<int>(pairs.size());
+    Encoder encoder;
+    Decoder decoder;
+    Packet sd;
+    SmallItem v;
+    ItemInfo info;
+    int packets = 0, next = 0;
+    for (int i=0; i<items; i++){
+        encoder.enq(item(i));
+        while (encoder.deq(&sd) == Status::OK){
+            const auto lost = pairs[packets/(parity_size+2)];
+            const int pos = packets%(parity_size+2);
+            packets++;
+            if (pos == lost.first || pos == lost.second)
+                continue;
+            decoder.enq(sd);
+        }
+        while (decoder.deq(&v, &info) == Status::OK){
+            expect_item(v, next);
+            EXPECT_EQ(info.index, static_cast<uint64_t>(next/K));
+            next++;
+        }
+    }
+    EXPECT_EQ(next, items);
+}
+
+TEST_F(CoalesceTest, timeout_test){
+    // a partial batch is sent when its first item is older than the timeout
+    Encoder encoder;
+    Decoder decoder;
+    encoder.set_timeout(std::chrono::milliseconds(5));
+    const Clock::time_point t0 {};
+    Packet sd;
+    SmallItem v;
+
+    EXPECT_EQ(encoder.enq(item(0), t0), Status::OK);
+    EXPECT_EQ(encoder.enq(item(1), t0 + std::chrono::milliseconds(1)), Status::OK);
+    EXPECT_EQ(encoder.poll(t0 + std::chrono::milliseconds(4)), Status::NO_ELEMENT);
+    EXPECT_EQ(encoder.count(), 0u);
+    EXPECT_EQ(encoder.poll(t0 + std::chrono::milliseconds(5)), Status::OK);
+    ASSERT_EQ(encoder.deq(&sd), Status::OK);
+    EXPECT_EQ(sd.data[0], 2); // count
+
+    // the unused items are not sent
+    EXPECT_EQ(wire_size(sd), offsetof(Packet, data) + offsetof(Item, items) + 2*sizeof(SmallItem));
+    Packet received;
+    ASSERT_TRUE(from_wire(&sd, wire_size(sd), &received));
+    decoder.enq(received);
+
+    // an item of an expired batch goes with it
+    EXPECT_EQ(encoder.enq(item(2), t0 + std::chrono::milliseconds(10)), Status::OK);
+    EXPECT_EQ(encoder.enq(item(3), t0 + std::chrono::milliseconds(20)), Status::OK);
+    EXPECT_EQ(encoder.pending(), 0u);
+    EXPECT_EQ(encoder.flush(), Status::NO_ELEMENT);
+    while (encoder.deq(&sd) == Status::OK)
+        decoder.enq(sd);
+
+    std::vector<uint32_t> ids;
+    while (decoder.deq(&v) == Status::OK)
+        ids.push_back(v.id);
+    EXPECT_EQ(ids, (std::vector<uint32_t>{0, 1, 2, 3}));
+}
+
+TEST_F(CoalesceTest, partial_batch_test){
+    // flushed partial batches of random sizes with random losses
+    Encoder encoder;
+    Decoder decoder;
+    std::mt19937 rng(9);
+    Packet sd;
+    SmallItem v;
+    ItemInfo info;
+    int next = 0, received = 0, lost_batches = 0;
+    for (int i=0; i<5000; i++){
+        encoder.enq(item(i));
+        if (rng()%5 == 0)
+            encoder.flush();
+        while (encoder.deq(&sd) == Status::OK){
+            if (rng()%100 < 5)
+                continue;
+            decoder.enq(sd);
+        }
+        for (Status status; (status = decoder.deq(&v, &info)) != Status::NO_ELEMENT;){
+            if (status == Status::LOST){
+                lost_batches += info.lost;
+                continue;
+            }
+            ASSERT_GE(static_cast<int>(v.id), next);
+            expect_item(v, v.id);
+            next = v.id + 1;
+            received++;
+        }
+    }
+    EXPECT_GT(received, 4800);
+    EXPECT_LT(lost_batches, 20);
+}
+
+TEST_F(CoalesceTest, buffer_full_test){
+    // the output holds a group: the item which would overflow it is not enqueued
+    Encoder encoder;
+    for (int i=0; i<K*parity_size; i++)
+        EXPECT_NE(encoder.enq(item(i)), Status::BUFFER_FULL);
+    for (int i=0; i<K-1; i++)
+        EXPECT_EQ(encoder.enq(item(100+i)), Status::OK);
+    EXPECT_EQ(encoder.enq(item(200)), Status::BUFFER_FULL);
+    EXPECT_EQ(encoder.pending(), static_cast<size_t>(K-1));
+
+    Packet sd;
+    while (encoder.deq(&sd) == Status::OK){}
+    EXPECT_EQ(encoder.enq(item(200)), Status::OK);
+    ASSERT_EQ(encoder.deq(&sd), Status::OK);
+    Item batch;
+    memcpy(&batch, sd.data, sizeof(batch));
+    EXPECT_EQ(batch.count, K);
+    expect_item(batch.items[K-1], 200);
+}
+
+TEST_F(CoalesceTest, invalid_test){
+    Decoder decoder;
+    Packet sd {};
+    Item batch {};
+    batch.count = K+1;
+    SmallItem v;
+    ItemInfo info;
+    for (int pos=0; pos<parity_size; pos++){
+        sd.header.seq_id = pos;
+        memcpy(sd.data, &batch, sizeof(batch));
+        decoder.enq(sd);
+        batch.count = 1;
+    }
+    EXPECT_EQ(decoder.deq(&v, &info), Status::INVALID_ARGUMENT);
+    EXPECT_EQ(decoder.deq(&v, &info), Status::OK);
+}
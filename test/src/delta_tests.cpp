@@ -0,0 +1,203 @@
+#include "gtest/gtest.h"
+#include "RPPP_delta.hpp"
+#include <vector>
+#include <random>
+
+using namespace rppp;
+
+class DeltaTest : public ::testing::Test {
+
+protected:
+    // a game state snapshot (example.cpp)
+    struct Snapshot{
+        int pos[3];
+        int rot[3];
+        int sca[3];
+        float health;
+        uint16_t id;
+        uint16_t pad;
+    };
+    static constexpr int parity_size = 10;
+    using Packet = StreamData<Delta<Snapshot>, parity_size>;
+
+    static Snapshot tick(int i){
+        Snapshot s {};
+        s.pos[0] = 1000 + i;
+        s.pos[1] = 20;
+        s.pos[2] = -300 + i/4;
+        s.rot[1] = (i*3)%360;
+        s.sca[0] = s.sca[1] = s.sca[2] = 1;
+        s.health = (i < 50) ? 100.0f : 75.0f;
+        s.id = 7;
+        return s;
+    }
+};
+
+TEST_F(DeltaTest, zrle_test){
+    std::mt19937 rng(1);
+    for (int round=0; round<2000; round++){
+        // sparse changes, long zero runs and dense runs over 255 bytes
+        std::vector<uint8_t> x(rng()%700);
+        const int density = rng()%4;
+        for (auto& b : x){
+            if (density == 3 || rng()%8 < static_cast<unsigned>(density))
+                b = rng();
+        }
+        std::vector<uint8_t> out(x.size() + 2*((x.size() + 254)/255) + 2);
+        const size_t n = delta::encode_zrle(x.data(), x.size(), out.data());
+        ASSERT_LE(n, out.size());
+        std::vector<uint8_t> y(x.size());
+        ASSERT_TRUE(delta::apply_zrle(out.data(), out.size(), y.data(), y.size()));
+        EXPECT_EQ(x, y);
+    }
+    // tokens beyond the item are rejected
+    uint8_t bad[] = {10, 2, 1, 1};
+    uint8_t y[8] {};
+    EXPECT_FALSE(delta::apply_zrle(bad, sizeof(bad), y, sizeof(y)));
+}
+
+TEST_F(DeltaTest, fec_test){
+    // delta -> EncodeBuffer -> wire (trailing zeros cut, a packet lost per group) -> DecodeBuffer -> delta
+    DeltaEncoder<Snapshot> d_enc;
+    DeltaDecoder<Snapshot> d_dec;
+    EncodeBuffer<Delta<Snapshot>, parity_size> e_buf;
+    DecodeBuffer<Delta<Snapshot>, parity_size> d_buf;
+    Packet sd, received;
+    Delta<Snapshot> delta;
+    Snapshot out;
+    std::vector<uint8_t> wire(sizeof(Packet));
+    size_t wire_bytes = 0, packets = 0;
+    int next = 0;
+
+    for (int i=0; i<100*parity_size; i++){
+        d_enc.encode(tick(i), &delta);
+        e_buf.enq(delta);
+        while (e_buf.deq(&sd) == Status::OK){
+            const size_t size = wire_size(sd);
+            memcpy(wire.data(), &sd, size);
+            wire_bytes += size;
+            packets++;
+            if (packets%(parity_size+2) == static_cast<size_t>(i/parity_size)%(parity_size+2))
+                continue;
+            ASSERT_TRUE(from_wire(wire.data(), size, &received));
+            d_buf.enq(received);
+        }
+        while (d_buf.deq(&delta) == Status::OK){
+            ASSERT_EQ(d_dec.decode(delta, &out), Status::OK);
+            const Snapshot expected = tick(next);
+            EXPECT_EQ(memcmp(&out, &expected, sizeof(Snapshot)), 0) << next;
+            next++;
+        }
+    }
+    EXPECT_EQ(next, 100*parity_size);
+    // less than half of the full packets (the Q packets stay long)
+    EXPECT_LT(wire_bytes, packets*sizeof(Packet)/2);
+}
+
+TEST_F(DeltaTest, keyframe_test){
+    // an unrecoverable loss breaks the chain until the next keyframe
+    DeltaEncoder<Snapshot> d_enc;
+    DeltaDecoder<Snapshot> d_dec;
+    d_enc.set_keyframe_interval(8);
+    Delta<Snapshot> delta;
+    Snapshot out;
+    std::vector<Status> status;
+    for (int i=0; i<20; i++){
+        d_enc.encode(tick(i), &delta);
+        EXPECT_EQ(delta.distance, (i%8 == 0) ? 0 : 1);
+        if (i == 3)
+            continue;
+        status.push_back(d_dec.decode(delta, &out));
+        if (status.back() == Status::OK){
+            const Snapshot expected = tick(i);
+            EXPECT_EQ(memcmp(&out, &expected, sizeof(Snapshot)), 0);
+        }
+    }
+    for (int i=0; i<19; i++){
+        const int item = (i < 3) ? i : i+1;
+        EXPECT_EQ(status[i], (item > 3 && item < 8) ? Status::LOST : Status::OK) << item;
+    }
+}
+
+TEST_F(DeltaTest, acked_test){
+    DeltaEncoder<Snapshot, 16> d_enc;
+    DeltaDecoder<Snapshot, 16> d_dec;
+    d_enc.set_mode(DeltaMode::ACKED);
+    Delta<Snapshot> delta;
+    Snapshot out;
+
+    // no ack yet: keyframes
+    d_enc.encode(tick(0), &delta);
+    EXPECT_EQ(delta.distance, 0);
+    ASSERT_EQ(d_dec.decode(delta, &out), Status::OK);
+    d_enc.ack(static_cast<uint32_t>(d_dec.last()));
+
+    // against item 0 while the acks don't come (lost items don't matter)
+    for (int i=1; i<10; i++){
+        d_enc.encode(tick(i), &delta);
+        EXPECT_EQ(delta.distance, i);
+        if (i%2)
+            continue;
+        ASSERT_EQ(d_dec.decode(delta, &out), Status::OK);
+        const Snapshot expected = tick(i);
+        EXPECT_EQ(memcmp(&out, &expected, sizeof(Snapshot)), 0);
+    }
+    d_enc.ack(8);
+    d_enc.ack(4); // an old ack doesn't move the baseline back
+    d_enc.encode(tick(10), &delta);
+    EXPECT_EQ(delta.distance, 2);
+
+    // the acked item left the history: keyframe
+    for (int i=11; i<30; i++)
+        d_enc.encode(tick(i), &delta);
+    EXPECT_EQ(delta.distance, 0);
+    EXPECT_EQ(d_dec.decode(delta, &out), Status::OK);
+    EXPECT_EQ(d_dec.last(), 29);
+}
+
+TEST_F(DeltaTest, reset_test){
+    // the keyframe after DeltaEncoder::reset() is lost: the new seq 1 must not decode against the old item 0
+    DeltaEncoder<Snapshot> d_enc;
+    DeltaDecoder<Snapshot> d_dec;
+    Delta<Snapshot> delta, old;
+    Snapshot out;
+    for (int i=0; i<5; i++){
+        d_enc.encode(tick(i), &delta);
+        ASSERT_EQ(d_dec.decode(delta, &out), Status::OK);
+    }
+    old = delta;
+
+    d_enc.reset();
+    d_enc.set_keyframe_interval(3);
+    for (int i=0; i<6; i++){
+        d_enc.encode(tick(100+i), &delta);
+        EXPECT_EQ(delta.seq, static_cast<uint32_t>(i));
+        if (i == 0)
+            continue;
+        const Status status = d_dec.decode(delta, &out);
+        EXPECT_EQ(status, (i < 3) ? Status::LOST : Status::OK) << i;
+        if (status == Status::OK){
+            const Snapshot expected = tick(100+i);
+            EXPECT_EQ(memcmp(&out, &expected, sizeof(Snapshot)), 0) << i;
+        }
+    }
+    EXPECT_EQ(d_dec.last(), 5);
+
+    // a delayed item of the old epoch
+    EXPECT_EQ(d_dec.decode(old, &out), Status::LOST);
+    EXPECT_EQ(d_dec.last(), 5);
+}
+
+TEST_F(DeltaTest, wire_test){
+    Packet sd {}, back;
+    sd.header.seq_id = 3;
+    EXPECT_EQ(wire_size(sd), offsetof(Packet, data));
+    sd.data[5] = 1;
+    EXPECT_EQ(wire_size(sd), offsetof(Packet, data) + 6);
+    std::vector<uint8_t> wire(sizeof(Packet), 0xff);
+    memcpy(wire.data(), &sd, wire_size(sd));
+    ASSERT_TRUE(from_wire(wire.data(), wire_size(sd), &back));
+    EXPECT_EQ(memcmp(&sd, &back, sizeof(Packet)), 0);
+    EXPECT_FALSE(from_wire(wire.data(), sizeof(Packet)+1, &back));
+    EXPECT_FALSE(from_wire(wire.data(), 1, &back));
+}
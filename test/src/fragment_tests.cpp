@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+#include "RPPP_fragment.hpp"
+#include <vector>
+#include <memory>
+#include <random>
+
+using namespace rppp;
+
+class FragmentTest : public ::testing::Test {
+
+protected:
+    static constexpr size_t max_message = 16000;
+    static constexpr size_t shard_bytes = 1200;
+    using Encoder = FragmentEncoder<max_message, shard_bytes>;
+    using Decoder = FragmentDecoder<max_message, shard_bytes>;
+    using Packet = Encoder::Packet;
+
+    static std::vector<uint8_t> message(int i, size_t size){
+        std::vector<uint8_t> m(size);
+        for (size_t b=0; b<size; b++)
+            m[b] = static_cast<uint8_t>(i*31 + b*7 + (b >> 8));
+        return m;
+    }
+
+    // the wire packets of a message
+    static std::vector<std::vector<uint8_t>> encode(Encoder& encoder, const std::vector<uint8_t>& m){
+        EXPECT_EQ(encoder.enq(m.data(), m.size()), Status::OK_PARITY_GENERATED);
+        std::vector<std::vector<uint8_t>> wire;
+        Packet f;
+        while (encoder.deq(&f) == Status::OK){
+            const auto *p = reinterpret_cast<const uint8_t*>(&f);
+            wire.emplace_back(p, p + f.wire_size());
+        }
+        return wire;
+    }
+};
+
+TEST_F(FragmentTest, layout_test){
+    // 16000 bytes in shards of <= 1200: 14 columns, 16 with 17 prime
+    EXPECT_EQ(Encoder::shards, 16);
+    EXPECT_EQ(Encoder::bytes, 1200u);
+    EXPECT_EQ(sizeof(FragmentHeader), 12u);
+
+    auto encoder = std::make_unique<Encoder>();
+    auto wire = encode(*encoder, message(0, 5000));
+    ASSERT_EQ(wire.size(), 5u + 2u);   // 5 data shards, P, Q
+    for (int i=0; i<4; i++)
+        EXPECT_EQ(wire[i].size(), sizeof(FragmentHeader) + 1200);
+    EXPECT_EQ(wire[4].size(), sizeof(FragmentHeader) + 200);
+    EXPECT_LE(wire[5].size(), sizeof(Packet));
+
+    // a small message is a data shard + P + Q
+    wire = encode(*encoder, message(1, 100));
+    ASSERT_EQ(wire.size(), 3u);
+    EXPECT_EQ(wire[0].size(), sizeof(FragmentHeader) + 100);
+    EXPECT_EQ(wire[1].size(), sizeof(FragmentHeader) + 100); // P = the data
+
+    EXPECT_EQ(encoder->enq(nullptr, 0), Status::INVALID_ARGUMENT);
+    EXPECT_EQ(encoder->enq(nullptr, max_message+1), Status::INVALID_ARGUMENT);
+}
+
+TEST_F(FragmentTest, drop_test){
+    // every pair of lost shards of a message
+    auto encoder = std::make_unique<Encoder>();
+    auto decoder = std::make_unique<Decoder>();
+    span<const uint8_t> out;
+    ItemInfo info;
+    int number = 0;
+    for (size_t size : {1000, 5000, 14400, 16000}){
+        const int packets = static_cast<int>((size + Encoder::bytes - 1)/Encoder::bytes) + 2;
+        for (int a=0; a<packets; a++){
+            for (int b=a; b<packets; b++){
+                const auto m = message(number, size);
+                const auto wire = encode(*encoder, m);
+                ASSERT_EQ(static_cast<int>(wire.size()), packets);
+                for (int i=0; i<packets; i++){
+                    if (i != a && i != b){
+                        ASSERT_EQ(decoder->enq(wire[i].data(), wire[i].size()), Status::OK);
+                    }
+                }
+                ASSERT_EQ(decoder->deq(&out, &info), Status::OK) << size << " " << a << " " << b;
+                EXPECT_EQ(info.index, static_cast<uint64_t>(number));
+                EXPECT_EQ(info.recovered, a < packets-2);
+                ASSERT_EQ(out.size(), size);
+                EXPECT_EQ(memcmp(out.data(), m.data(), size), 0) << size << " " << a << " " << b;
+                EXPECT_EQ(decoder->deq(&out, &info), Status::NO_ELEMENT);
+                number++;
+            }
+        }
+    }
+}
+
+TEST_F(FragmentTest, loss_test){
+    // 3 lost shards: the message is given up when a message 2 ahead arrives
+    auto encoder = std::make_unique<Encoder>();
+    auto decoder = std::make_unique<Decoder>();
+    span<const uint8_t> out;
+    ItemInfo info;
+    std::vector<int> delivered;
+    for (int i=0; i<5; i++){
+        auto wire = encode(*encoder, message(i, 4000));
+        for (size_t p=0; p<wire.size(); p++){
+            if (i == 1 && p < 3)
+                continue;
+            EXPECT_EQ(decoder->enq(wire[p].data(), wire[p].size()), Status::OK);
+        }
+        for (Status status; (status = decoder->deq(&out, &info)) != Status::NO_ELEMENT;){
+            if (status == Status::LOST){
+                EXPECT_EQ(info.index, 1u);
+                EXPECT_EQ(info.lost, 1u);
+                delivered.push_back(-1);
+                continue;
+            }
+            const auto m = message(static_cast<int>(info.index), 4000);
+            EXPECT_EQ(memcmp(out.data(), m.data(), m.size()), 0);
+            delivered.push_back(static_cast<int>(info.index));
+        }
+    }
+    EXPECT_EQ(delivered, (std::vector<int>{0, -1, 2, 3, 4}));
+}
+
+TEST_F(FragmentTest, reorder_test){
+    // the packets of 2 messages interleaved and shuffled, a packet of each lost
+    auto encoder = std::make_unique<Encoder>();
+    auto decoder = std::make_unique<Decoder>();
+    std::mt19937 rng(3);
+    span<const uint8_t> out;
+    int next = 0;
+    for (int round=0; round<200; round++){
+        const size_t size_a = 1 + rng()%max_message, size_b = 1 + rng()%max_message;
+        auto wire = encode(*encoder, message(2*round, size_a));
+        auto wire_b = encode(*encoder, message(2*round+1, size_b));
+        wire.erase(wire.begin() + rng()%wire.size());
+        wire_b.erase(wire_b.begin() + rng()%wire_b.size());
+        wire.insert(wire.end(), wire_b.begin(), wire_b.end());
+        std::shuffle(wire.begin(), wire.end(), rng);
+        for (auto& w : wire)
+            EXPECT_EQ(decoder->enq(w.data(), w.size()), Status::OK);
+        while (decoder->deq(&out) == Status::OK){
+            const auto m = message(next, (next%2) ? size_b : size_a);
+            ASSERT_EQ(out.size(), m.size());
+            EXPECT_EQ(memcmp(out.data(), m.data(), m.size()), 0);
+            next++;
+        }
+    }
+    EXPECT_EQ(next, 400);
+}
+
+TEST_F(FragmentTest, finish_test){
+    auto encoder = std::make_unique<Encoder>();
+    auto decoder = std::make_unique<Decoder>();
+    span<const uint8_t> out;
+    ItemInfo info;
+    auto wire = encode(*encoder, message(0, 3000));
+    auto wire_b = encode(*encoder, message(1, 3000));
+    for (size_t p=3; p<wire.size(); p++)
+        decoder->enq(wire[p].data(), wire[p].size());
+    for (auto& w : wire_b)
+        decoder->enq(w.data(), w.size());
+    EXPECT_EQ(decoder->deq(&out, &info), Status::NO_ELEMENT);
+    EXPECT_EQ(decoder->in_flight(), 2u);
+    decoder->finish();
+    EXPECT_EQ(decoder->deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 0u);
+    ASSERT_EQ(decoder->deq(&out, &info), Status::OK);
+    EXPECT_EQ(info.index, 1u);
+    EXPECT_EQ(decoder->deq(&out, &info), Status::NO_ELEMENT);
+}
+
+TEST_F(FragmentTest, invalid_test){
+    auto decoder = std::make_unique<Decoder>();
+    Packet f {};
+    f.header.size = 3000;
+    f.header.pos = 5; // a virtual column of a message of 3 shards
+    EXPECT_EQ(decoder->enq(&f, sizeof(Packet)), Status::INVALID_ARGUMENT);
+    f.header.pos = 0;
+    EXPECT_EQ(decoder->enq(&f, sizeof(Packet)+1), Status::INVALID_ARGUMENT);
+    f.header.size = max_message+1;
+    EXPECT_EQ(decoder->enq(&f, sizeof(Packet)), Status::INVALID_ARGUMENT);
+
+    // 8000 bytes in shards of <= 1400: 6 columns of 1398 bytes, Packet has 2 bytes of padding
+    using OddDecoder = FragmentDecoder<8000>;
+    using OddPacket = OddDecoder::Packet;
+    static_assert(OddDecoder::bytes == 1398, "");
+    static_assert(sizeof(OddPacket) > offsetof(OddPacket, data) + OddDecoder::bytes, "");
+    auto odd = std::make_unique<OddDecoder>();
+    OddPacket g {};
+    g.header.size = 8000;
+    g.header.pos = OddDecoder::shards+1; // Q
+    EXPECT_EQ(odd->enq(&g, sizeof(OddPacket)), Status::INVALID_ARGUMENT);
+    EXPECT_EQ(odd->enq(&g, offsetof(OddPacket, data) + OddDecoder::bytes), Status::OK);
+}
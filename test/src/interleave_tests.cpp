@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "RPPP_interleave.hpp"
+#include <vector>
+#include <cstring>
+
+using namespace rppp;
+
+class InterleaveTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        int y;
+        uint8_t z;
+    };
+
+    template<int parity_size, int depth>
+    std::vector<StreamData<NetVar, parity_size>> encode(int item_num){
+        InterleaveEncoder<NetVar, parity_size, depth> e_buf;
+        std::vector<StreamData<NetVar, parity_size>> pipe;
+        StreamData<NetVar, parity_size> sd;
+        for (int i=0; i<item_num; i++){
+            NetVar in {i, -i, static_cast<uint8_t>(i)};
+            EXPECT_NE(e_buf.enq(in), Status::BUFFER_FULL);
+            while (e_buf.deq(&sd) == Status::OK)
+                pipe.push_back(sd);
+        }
+        EXPECT_EQ(e_buf.count(), 0u);
+        return pipe;
+    }
+
+    template<int parity_size, int depth>
+    struct burst_test{
+    void operator()(InterleaveTest &t){
+        std::cout << parity_size << " " << depth << std::endl;
+        const int item_num = parity_size*depth*6;
+        auto pipe = t.encode<parity_size, depth>(item_num);
+
+        // no bandwidth overhead compared with EncodeBuffer
+        EXPECT_EQ(pipe.size(), static_cast<size_t>(item_num/parity_size*(parity_size+2)));
+        for (size_t i=0; i<pipe.size(); i++)
+            EXPECT_EQ(pipe[i].header.lane, i%depth);
+
+        // a burst of 2*depth packets at any position
+        for (size_t burst=0; burst+2*depth<=pipe.size(); burst+=3){
+            InterleaveDecoder<NetVar, parity_size, depth> d_buf;
+            std::vector<NetVar> out;
+            NetVar item;
+            for (size_t i=0; i<pipe.size(); i++){
+                if (i < burst || i >= burst+2*depth)
+                    d_buf.enq(pipe[i]);
+                while (d_buf.deq(&item) == Status::OK)
+                    out.push_back(item);
+            }
+            ASSERT_EQ(out.size(), static_cast<size_t>(item_num));
+            for (int i=0; i<item_num; i++){
+                EXPECT_EQ(out[i].x, i);
+                EXPECT_EQ(out[i].y, -i);
+            }
+        }
+    }
+    };
+};
+
+TEST_F(InterleaveTest, burst_test){
+    burst_test<2, 1>()(*this);
+    burst_test<4, 2>()(*this);
+    burst_test<4, 4>()(*this);
+    burst_test<6, 3>()(*this);
+    burst_test<10, 8>()(*this);
+}
+
+TEST_F(InterleaveTest, long_burst_test){
+    const int parity_size = 4, depth = 2;
+    const int item_num = parity_size*depth*4;
+    auto pipe = encode<parity_size, depth>(item_num);
+
+    // lost 3 packets of a lane: the items of the group are reported in order
+    InterleaveDecoder<NetVar, parity_size, depth> d_buf;
+    d_buf.set_deadline(std::chrono::seconds(0));
+    std::vector<int> xs;
+    std::vector<uint64_t> lost;
+    NetVar item;
+    ItemInfo info;
+    for (size_t i=0; i<pipe.size(); i++){
+        if (i < 12 || i >= 12+5)
+            d_buf.enq(pipe[i]);
+        Status status;
+        while ((status = d_buf.deq(&item, &info)) != Status::NO_ELEMENT){
+            if (status == Status::OK){
+                EXPECT_EQ(static_cast<uint64_t>(item.x), info.index);
+                xs.push_back(item.x);
+            }
+            else{
+                lost.push_back(info.index);
+            }
+        }
+    }
+    d_buf.poll();
+    while (d_buf.deq(&item, &info) != Status::NO_ELEMENT);
+    EXPECT_EQ(d_buf.count(), 0u);
+    EXPECT_EQ(xs.size() + lost.size(), static_cast<size_t>(item_num));
+    for (size_t i=1; i<xs.size(); i++)
+        EXPECT_LT(xs[i-1], xs[i]);
+    EXPECT_FALSE(lost.empty());
+}
@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+#include "RPPP_parallel.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+
+using namespace rppp;
+
+class ParallelTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int flow;
+        int x;
+    };
+
+    // blocks of 10000 bytes at parity_size = 4
+    struct Large{
+        int x;
+        uint8_t data[40000-sizeof(int)];
+    };
+};
+
+TEST_F(ParallelTest, parallel_for_test){
+    WorkStealingPool pool(3);
+    EXPECT_EQ(pool.concurrency(), 4u);
+
+    // every index exactly once, also from nested calls
+    const size_t n = 20000;
+    std::vector<std::atomic<int>> hits(n);
+    for (auto& h : hits)
+        h = 0;
+    pool.parallel_for(n/100, 3, [&](size_t begin, size_t end){
+        for (size_t i=begin; i<end; i++){
+            pool.parallel_for(100, 7, [&](size_t b, size_t e){
+                for (size_t j=b; j<e; j++)
+                    hits[i*100 + j]++;
+            });
+        }
+    });
+    for (size_t i=0; i<n; i++)
+        ASSERT_EQ(hits[i].load(), 1) << i;
+
+    // without workers, on the caller
+    WorkStealingPool alone(0);
+    size_t sum = 0;
+    alone.parallel_for(1000, 10, [&](size_t begin, size_t end){
+        for (size_t i=begin; i<end; i++)
+            sum += i;
+    });
+    EXPECT_EQ(sum, 999u*1000/2);
+}
+
+TEST_F(ParallelTest, column_split_test){
+    WorkStealingPool pool(3);
+    auto plain = std::make_unique<EncodeBuffer<Large, 4>>();
+    auto split = std::make_unique<EncodeBuffer<Large, 4>>();
+    split->set_splitter(pool.splitter(1024));
+
+    // the packets are the same with and without the splitter
+    std::vector<StreamData<Large, 4>> pipe;
+    auto in = std::make_unique<Large>();
+    auto sd = std::make_unique<StreamData<Large, 4>>();
+    auto sd2 = std::make_unique<StreamData<Large, 4>>();
+    for (int i=0; i<4*2; i++){
+        in->x = i;
+        for (size_t k=0; k<sizeof(in->data); k++)
+            in->data[k] = static_cast<uint8_t>(k*31 + i*7);
+        plain->enq(*in);
+        split->enq(*in);
+        while (plain->deq(sd.get()) == Status::OK){
+            ASSERT_EQ(split->deq(sd2.get()), Status::OK);
+            ASSERT_EQ(memcmp(sd->data, sd2->data, sizeof(sd->data)), 0);
+            pipe.push_back(*sd);
+        }
+    }
+
+    // every pair of lost columns (data and P) of a group is recovered in tasks
+    auto out = std::make_unique<Large>();
+    for (int a=0; a<5; a++){
+        for (int b=a; b<5; b++){
+            auto d_buf = std::make_unique<DecodeBuffer<Large, 4>>();
+            d_buf->set_splitter(pool.splitter(1024));
+            for (int i=0; i<12; i++){
+                if (i != a && i != b)
+                    d_buf->enq(pipe[i]);
+            }
+            for (int i=0; i<8; i++){
+                ASSERT_EQ(d_buf->deq(out.get()), Status::OK);
+                EXPECT_EQ(out->x, i);
+                EXPECT_EQ(memcmp(out->data, pipe[i < 4 ? i : i+2].data + sizeof(int), sizeof(out->data)), 0) << a << " " << b << " " << i;
+            }
+        }
+    }
+}
+
+TEST_F(ParallelTest, router_test){
+    using Manager = SessionManager<NetVar, 4>;
+    constexpr int flows = 200;
+    constexpr int items = 4*3;
+    WorkStealingPool pool(3);
+    Manager senders;
+    Manager receivers;
+
+    // two data packets of every group lost
+    std::vector<Manager::Data> packets;
+    std::vector<uint64_t> packet_flows;
+    for (int i=0; i<items; i++){
+        for (int f=0; f<flows; f++){
+            Manager::Session* s = senders.open(f);
+            s->encoder.enq(NetVar{f, i});
+            Manager::Data sd;
+            while (s->encoder.deq(&sd) == Status::OK){
+                const int pos = sd.header.seq_id%6;
+                if (pos == f%4 || pos == (f+1)%5)
+                    continue;
+                packets.push_back(sd);
+                packet_flows.push_back(s->flow);
+            }
+        }
+    }
+    std::vector<Manager::Datagram> datagrams;
+    for (size_t i=0; i<packets.size(); i++)
+        datagrams.push_back({packet_flows[i], &packets[i]});
+
+    ParallelRouter<Manager> router;
+    EXPECT_EQ(router.enq_batch(pool, receivers, datagrams), datagrams.size());
+    EXPECT_EQ(receivers.size(), static_cast<size_t>(flows));
+
+    std::atomic<int> done {0};
+    parallel_for_each(pool, receivers, 8, [&](Manager::Session& s){
+        NetVar out;
+        int next = 0;
+        while (s.decoder.deq(&out) == Status::OK){
+            EXPECT_EQ(static_cast<uint64_t>(out.flow), s.flow);
+            EXPECT_EQ(out.x, next++);
+        }
+        EXPECT_EQ(next, items);
+        done++;
+    });
+    EXPECT_EQ(done.load(), flows);
+}
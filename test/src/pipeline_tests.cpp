@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "RPPP_pipeline.hpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace rppp;
+
+class PipelineTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        int y;
+        uint8_t z;
+    };
+};
+
+TEST_F(PipelineTest, spsc_ring_test){
+    SpscRing<int, 4> ring;
+    int x;
+    EXPECT_FALSE(ring.pop(&x));
+    for (int i=0; i<4; i++)
+        EXPECT_TRUE(ring.push(i));
+    EXPECT_FALSE(ring.push(4));
+    EXPECT_EQ(ring.size(), 4u);
+
+    // wraps around
+    for (int i=0; i<100; i++){
+        EXPECT_TRUE(ring.pop(&x));
+        EXPECT_EQ(x, i);
+        EXPECT_TRUE(ring.push(i+4));
+    }
+
+    // two threads, the ring is full and empty many times
+    SpscRing<int, 64> shared;
+    const int num = 1000000;
+    std::thread producer([&]{
+        for (int i=0; i<num;){
+            if (shared.push(i))
+                i++;
+            else
+                std::this_thread::yield();
+        }
+    });
+    int next = 0;
+    while (next < num){
+        if (shared.pop(&x))
+            ASSERT_EQ(x, next++);
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    EXPECT_FALSE(shared.pop(&x));
+}
+
+TEST_F(PipelineTest, stress_test){
+    // game thread -> network thread (encode, lose, decode) -> game thread
+    PipelineEncoder<NetVar, 4, 64> encoder;
+    PipelineDecoder<NetVar, 4, 64> decoder;
+    const int num = 4*50000;
+    std::atomic<bool> sent {false};
+
+    std::thread game_out([&]{
+        for (int i=0; i<num;){
+            if (encoder.enq(NetVar{i, -i, static_cast<uint8_t>(i)}) == Status::OK)
+                i++;
+            else
+                std::this_thread::yield();
+        }
+        sent = true;
+    });
+    std::thread network([&]{
+        StreamData<NetVar, 4> sd;
+        int packets = 0;
+        for (;;){
+            const bool done = sent;
+            bool idle = true;
+            decoder.poll();
+            if (decoder.waiting()){ // the game thread is behind
+                std::this_thread::yield();
+                continue;
+            }
+            while (decoder.waiting() == 0 && encoder.deq(&sd) == Status::OK){
+                idle = false;
+                if (packets++%7 == 3) // a packet of a group at most
+                    continue;
+                decoder.enq(sd);
+            }
+            if (done && idle && encoder.queued() == 0)
+                break;
+            if (idle)
+                std::this_thread::yield();
+        }
+        decoder.decoder().finish();
+        while (decoder.waiting()){
+            decoder.poll();
+            std::this_thread::yield();
+        }
+    });
+
+    NetVar out;
+    int next = 0;
+    while (next < num){
+        if (decoder.deq(&out) == Status::OK){
+            ASSERT_EQ(out.x, next);
+            ASSERT_EQ(out.y, -next);
+            next++;
+        }
+        else
+            std::this_thread::yield();
+    }
+    game_out.join();
+    network.join();
+    EXPECT_EQ(decoder.deq(&out), Status::NO_ELEMENT);
+}
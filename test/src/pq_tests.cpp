@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "RPPP.hpp"
+#include "RPPP_runtime.hpp"
+#include "RPPP_fragment.hpp"
+#include <vector>
+#include <memory>
+#include <random>
+
+using namespace rppp;
+
+/*
+every single and double loss of a group through the P/Q codecs (DecodeBuffer,
+VarDecodeBuffer and FragmentDecoder), with random contents
+*/
+class PqTest : public ::testing::Test {
+
+protected:
+    std::mt19937 m_rng {11};
+
+    // lost positions of a group: (a, a) is a single loss
+    static std::vector<std::pair<int, int>> loss_patterns(int packets){
+        std::vector<std::pair<int, int>> patterns;
+        for (int a=0; a<packets; a++){
+            for (int b=a; b<packets; b++)
+                patterns.emplace_back(a, b);
+        }
+        return patterns;
+    }
+
+    std::vector<uint8_t> random_bytes(size_t size){
+        std::vector<uint8_t> bytes(size);
+        for (auto& b : bytes)
+            b = static_cast<uint8_t>(m_rng());
+        return bytes;
+    }
+
+    template<int parity_size>
+    void block_codec(){
+        struct Item{
+            uint8_t bytes[45];
+        };
+        auto encoder = std::make_unique<EncodeBuffer<Item, parity_size>>();
+        auto decoder = std::make_unique<DecodeBuffer<Item, parity_size>>();
+        StreamData<Item, parity_size> sd;
+        for (auto lost : loss_patterns(parity_size+2)){
+            std::vector<Item> items(parity_size);
+            int pos = 0;
+            for (auto& item : items){
+                const auto bytes = random_bytes(sizeof(Item));
+                memcpy(&item, bytes.data(), sizeof(Item));
+                encoder->enq(item);
+                while (encoder->deq(&sd) == Status::OK){
+                    if (pos != lost.first && pos != lost.second)
+                        decoder->enq(sd);
+                    pos++;
+                }
+            }
+            Item out;
+            for (auto& item : items){
+                ASSERT_EQ(decoder->deq(&out), Status::OK) << parity_size << " " << lost.first << " " << lost.second;
+                EXPECT_EQ(memcmp(&out, &item, sizeof(Item)), 0) << parity_size << " " << lost.first << " " << lost.second;
+            }
+            EXPECT_EQ(decoder->deq(&out), Status::NO_ELEMENT);
+        }
+    }
+
+    void var_codec(int parity_size, size_t max_payload){
+        VarEncodeBuffer encoder(parity_size, max_payload);
+        VarDecodeBuffer decoder(parity_size, max_payload);
+        ASSERT_TRUE(encoder.valid() && decoder.valid());
+        std::vector<uint8_t> packet(encoder.packet_capacity()), out(max_payload);
+        size_t len;
+        for (auto lost : loss_patterns(parity_size+2)){
+            std::vector<std::vector<uint8_t>> messages;
+            int pos = 0;
+            for (int i=0; i<parity_size; i++){
+                messages.push_back(random_bytes(m_rng()%(max_payload+1)));
+                encoder.enq(messages.back().data(), messages.back().size());
+                while (encoder.deq(packet.data(), &len) == Status::OK){
+                    if (pos != lost.first && pos != lost.second)
+                        decoder.enq(packet.data(), len);
+                    pos++;
+                }
+            }
+            for (auto& m : messages){
+                ASSERT_EQ(decoder.deq(out.data(), &len), Status::OK) << parity_size << " " << lost.first << " " << lost.second;
+                ASSERT_EQ(len, m.size());
+                EXPECT_EQ(memcmp(out.data(), m.data(), len), 0) << parity_size << " " << lost.first << " " << lost.second;
+            }
+            EXPECT_EQ(decoder.deq(out.data(), &len), Status::NO_ELEMENT);
+        }
+    }
+
+    // messages of every number of data shards (the others are virtual zero columns)
+    template<size_t max_message, size_t shard_bytes>
+    void fragment_codec(){
+        using Encoder = FragmentEncoder<max_message, shard_bytes>;
+        auto encoder = std::make_unique<Encoder>();
+        auto decoder = std::make_unique<FragmentDecoder<max_message, shard_bytes>>();
+        typename Encoder::Packet f;
+        span<const uint8_t> out;
+        for (size_t k=1; k*Encoder::bytes < max_message + Encoder::bytes; k++){
+            for (auto lost : loss_patterns(static_cast<int>(k)+2)){
+                const size_t size = std::min(max_message, (k-1)*Encoder::bytes + 1 + m_rng()%Encoder::bytes);
+                const auto m = random_bytes(size);
+                ASSERT_EQ(encoder->enq(m.data(), m.size()), Status::OK_PARITY_GENERATED);
+                for (int pos=0; encoder->deq(&f) == Status::OK; pos++){
+                    if (pos != lost.first && pos != lost.second){
+                        ASSERT_EQ(decoder->enq(&f, f.wire_size()), Status::OK);
+                    }
+                }
+                ASSERT_EQ(decoder->deq(&out), Status::OK) << k << " " << lost.first << " " << lost.second;
+                ASSERT_EQ(out.size(), size);
+                EXPECT_EQ(memcmp(out.data(), m.data(), size), 0) << k << " " << lost.first << " " << lost.second;
+            }
+        }
+    }
+};
+
+TEST_F(PqTest, drop_fuzz_test){
+    for (int round=0; round<3; round++){
+        block_codec<2>();
+        block_codec<4>();
+        block_codec<8>();   // padded to 10
+        block_codec<10>();
+        block_codec<30>();
+
+        var_codec(2, 40);
+        var_codec(4, 300);
+        var_codec(10, 1200);
+        var_codec(5, 100);      // padded to 6
+        var_codec(8, 500);      // padded to 10
+    }
+    fragment_codec<3000, 200>();    // 16 columns of 192 bytes
+    fragment_codec<16000, 1200>();
+}
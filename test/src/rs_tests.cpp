@@ -0,0 +1,222 @@
+#include "gtest/gtest.h"
+#include "RPPP_rs.hpp"
+#include <vector>
+#include <random>
+
+using namespace rppp;
+
+class RsTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        uint8_t pad[45];
+    };
+
+    template<int k, int m>
+    static std::vector<StreamData<NetVar, 1>> encode(int items){
+        RsEncodeBuffer<NetVar, k, m> encoder;
+        std::vector<StreamData<NetVar, 1>> packets;
+        StreamData<NetVar, 1> sd;
+        for (int i=0; i<items; i++){
+            NetVar v {};
+            v.x = i;
+            for (size_t b=0; b<sizeof(v.pad); b++)
+                v.pad[b] = static_cast<uint8_t>(i*31 + b);
+            EXPECT_NE(encoder.enq(v), Status::BUFFER_FULL);
+            while (encoder.deq(&sd) == Status::OK)
+                packets.push_back(sd);
+        }
+        return packets;
+    }
+
+    static void expect_item(const NetVar& v, int i){
+        EXPECT_EQ(v.x, i);
+        for (size_t b=0; b<sizeof(v.pad); b++)
+            EXPECT_EQ(v.pad[b], static_cast<uint8_t>(i*31 + b));
+    }
+};
+
+TEST_F(RsTest, gf256_test){
+    for (int a=1; a<256; a++){
+        EXPECT_EQ(gf256::mul(a, gf256::inv(a)), 1);
+        EXPECT_EQ(gf256::mul(a, 1), a);
+        EXPECT_EQ(gf256::mul(a, 0), 0);
+    }
+    // distributive over xor
+    std::mt19937 rng(1);
+    for (int i=0; i<1000; i++){
+        const uint8_t a = rng(), b = rng(), c = rng();
+        EXPECT_EQ(gf256::mul(a, b ^ c), gf256::mul(a, b) ^ gf256::mul(a, c));
+        EXPECT_EQ(gf256::mul(a, b), gf256::mul(b, a));
+    }
+}
+
+TEST_F(RsTest, kernel_test){
+    std::mt19937 rng(2);
+    std::vector<uint8_t> src(1000), expected(1000), actual(1000);
+    for (auto& b : src)
+        b = rng();
+    for (gf256::GfIsa isa : {gf256::GfIsa::PORTABLE, gf256::GfIsa::SSSE3, gf256::GfIsa::AVX2}){
+        if (not gf256::gf_isa_supported(isa))
+            continue;
+        const gf256::GfKernel kernel = gf256::gf_kernel_for(isa);
+        for (int c : {2, 3, 0x1d, 0x80, 0xff}){
+            for (size_t len : {0, 1, 15, 16, 31, 33, 64, 999}){
+                for (size_t i=0; i<len; i++)
+                    expected[i] = actual[i] = static_cast<uint8_t>(i);
+                gf256::mul_acc_portable(expected.data(), src.data(), c, len);
+                kernel.mul_acc(actual.data(), src.data(), c, len);
+                EXPECT_TRUE(std::equal(expected.begin(), expected.begin()+len, actual.begin())) << kernel.name << " c=" << c << " len=" << len;
+            }
+        }
+    }
+}
+
+TEST_F(RsTest, no_loss_test){
+    auto packets = encode<5, 3>(5*20);
+    EXPECT_EQ(packets.size(), 8u*20);
+    RsDecodeBuffer<NetVar, 5, 3> decoder;
+    NetVar v;
+    int i = 0;
+    for (auto& sd : packets){
+        EXPECT_EQ(decoder.enq(sd), Status::OK);
+        while (decoder.deq(&v) == Status::OK)
+            expect_item(v, i++);
+    }
+    EXPECT_EQ(i, 5*20);
+}
+
+TEST_F(RsTest, erasure_pattern_test){
+    // every pattern of up to m lost packets of a group (k=4, m=3)
+    constexpr int k = 4, m = 3;
+    auto packets = encode<k, m>(k);
+    for (int mask=0; mask<(1 << (k+m)); mask++){
+        if (__builtin_popcount(mask) > m)
+            continue;
+        RsDecodeBuffer<NetVar, k, m> decoder;
+        for (int pos=0; pos<k+m; pos++){
+            if (not (mask & (1 << pos)))
+                decoder.enq(packets[pos]);
+        }
+        NetVar v;
+        ItemInfo info;
+        for (int i=0; i<k; i++){
+            ASSERT_EQ(decoder.deq(&v, &info), Status::OK) << "mask=" << mask;
+            expect_item(v, i);
+            EXPECT_EQ(info.recovered, (mask >> i) & 1);
+        }
+        EXPECT_EQ(decoder.deq(&v), Status::NO_ELEMENT);
+    }
+}
+
+TEST_F(RsTest, random_loss_test){
+    // k=10, m=4: up to 4 losses of a group are recovered, reordered within 2 groups
+    constexpr int k = 10, m = 4;
+    constexpr int groups = 300;
+    auto packets = encode<k, m>(k*groups);
+    std::mt19937 rng(3);
+    std::vector<StreamData<NetVar, 1>> sent;
+    std::vector<int> lost(groups);
+    for (int g=0; g<groups; g++){
+        const int losses = rng()%(m+3);
+        std::vector<int> pos(k+m);
+        for (int i=0; i<k+m; i++)
+            pos[i] = i;
+        std::shuffle(pos.begin(), pos.end(), rng);
+        for (int i=0; i<losses; i++){
+            if (pos[i] < k)
+                lost[g]++;
+        }
+        if (losses <= m)
+            lost[g] = 0;
+        std::sort(pos.begin()+losses, pos.end());
+        for (int i=losses; i<k+m; i++)
+            sent.push_back(packets[g*(k+m) + pos[i]]);
+    }
+    for (size_t i=0; i+1<sent.size(); i+=2){
+        if (rng()%4 == 0)
+            std::swap(sent[i], sent[i+1]);
+    }
+
+    RsDecodeBuffer<NetVar, k, m> decoder;
+    NetVar v;
+    ItemInfo info;
+    int next = 0, given_up = 0;
+    auto drain = [&]{
+        for (;;){
+            const Status status = decoder.deq(&v, &info);
+            if (status == Status::NO_ELEMENT)
+                return;
+            ASSERT_EQ(info.index, static_cast<uint64_t>(next));
+            if (status == Status::LOST){
+                next += info.lost;
+                given_up += info.lost;
+            }
+            else{
+                expect_item(v, next++);
+            }
+        }
+    };
+    for (auto& sd : sent){
+        EXPECT_EQ(decoder.enq(sd), Status::OK);
+        drain();
+    }
+    decoder.finish();
+    drain();
+
+    int expected_lost = 0;
+    for (int g : lost)
+        expected_lost += g;
+    EXPECT_EQ(next, k*groups);
+    EXPECT_EQ(given_up, expected_lost);
+}
+
+TEST_F(RsTest, reset_test){
+    RsEncodeBuffer<NetVar, 3, 2> encoder;
+    RsDecodeBuffer<NetVar, 3, 2> decoder;
+    StreamData<NetVar, 1> sd;
+    NetVar v {};
+    for (int i=0; i<4; i++){
+        v.x = i;
+        encoder.enq(v);
+        while (encoder.deq(&sd) == Status::OK)
+            decoder.enq(sd);
+    }
+
+    // a new epoch starts from item 0 after the reset
+    encoder.reset();
+    for (int i=0; i<3; i++){
+        v.x = 100+i;
+        encoder.enq(v);
+    }
+    while (encoder.deq(&sd) == Status::OK)
+        decoder.enq(sd);
+    std::vector<int> out;
+    while (decoder.deq(&v) == Status::OK)
+        out.push_back(v.x);
+    EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 100, 101, 102}));
+}
+
+TEST_F(RsTest, group_header_test){
+    // GroupHeader: the position is checked against data_size+parity_count
+    RsEncodeBuffer<NetVar, 3, 2, GroupHeader> encoder;
+    RsDecodeBuffer<NetVar, 3, 2, 2, GroupHeader> decoder;
+    StreamData<NetVar, 1, GroupHeader> sd;
+    NetVar v {};
+    for (int i=0; i<6; i++){
+        v.x = i;
+        encoder.enq(v);
+        while (encoder.deq(&sd) == Status::OK){
+            if (sd.header.pos != 1){
+                EXPECT_EQ(decoder.enq(sd), Status::OK);
+            }
+        }
+    }
+    sd.header.pos = 5;
+    EXPECT_EQ(decoder.enq(sd), Status::INVALID_ARGUMENT);
+    std::vector<int> out;
+    while (decoder.deq(&v) == Status::OK)
+        out.push_back(v.x);
+    EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4, 5}));
+}
@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+#include "RPPP_runtime.hpp"
+#include <vector>
+#include <string>
+#include <cstring>
+
+using namespace rppp;
+
+class RuntimeTest : public ::testing::Test {
+
+protected:
+    using Packet = std::vector<uint8_t>;
+
+    // message i: (i*7)%max_payload bytes of i
+    static std::string message(int i, size_t max_payload){
+        return std::string((i*7)%(max_payload+1), static_cast<char>(i));
+    }
+
+    static std::vector<Packet> encode(int parity_size, size_t max_payload, int item_num){
+        VarEncodeBuffer e_buf(parity_size, max_payload);
+        EXPECT_TRUE(e_buf.valid());
+        std::vector<Packet> pipe;
+        std::vector<uint8_t> buf(e_buf.packet_capacity());
+        size_t len;
+        for (int i=0; i<item_num; i++){
+            std::string m = message(i, max_payload);
+            EXPECT_NE(e_buf.enq(m.data(), m.size()), Status::BUFFER_FULL);
+            while (e_buf.deq(buf.data(), &len) == Status::OK)
+                pipe.emplace_back(buf.begin(), buf.begin() + len);
+        }
+        return pipe;
+    }
+};
+
+TEST_F(RuntimeTest, invalid_test){
+    EXPECT_TRUE(VarEncodeBuffer(5, 100).valid());   // padded to 6
+    EXPECT_FALSE(VarEncodeBuffer(1, 100).valid());
+    EXPECT_FALSE(VarEncodeBuffer(256, 100).valid());
+    EXPECT_FALSE(VarEncodeBuffer(4, 70000).valid());
+    EXPECT_TRUE(VarDecodeBuffer(8, 100).valid());    // padded to 10
+    EXPECT_FALSE(VarDecodeBuffer(1, 100).valid());
+    EXPECT_FALSE(VarDecodeBuffer(4, 100, 0).valid());
+
+    VarEncodeBuffer e_buf(4, 100);
+    uint8_t data[101] {};
+    EXPECT_EQ(e_buf.enq(data, 101), Status::INVALID_ARGUMENT);
+    EXPECT_EQ(e_buf.enq(data, 100), Status::OK);
+
+    VarDecodeBuffer d_buf(4, 100);
+    uint8_t packet[sizeof(VarHeader)+4] {};
+    VarHeader header {{0, 0, 0}, 5};
+    memcpy(packet, &header, sizeof(header));
+    EXPECT_EQ(d_buf.enq(packet, 3), Status::INVALID_ARGUMENT);
+    EXPECT_EQ(d_buf.enq(packet, sizeof(packet)), Status::INVALID_ARGUMENT);
+    header.length = 4;
+    memcpy(packet, &header, sizeof(header));
+    EXPECT_EQ(d_buf.enq(packet, sizeof(packet)), Status::OK);
+    EXPECT_EQ(d_buf.count(), 1u);
+}
+
+TEST_F(RuntimeTest, wire_size_test){
+    const int parity_size = 4;
+    const size_t max_payload = 1000;
+    VarEncodeBuffer e_buf(parity_size, max_payload);
+    const size_t lengths[parity_size] = {0, 10, 3, 5};
+    uint8_t data[max_payload] {};
+    for (size_t len : lengths)
+        e_buf.enq(data, len);
+
+    ASSERT_EQ(e_buf.count(), static_cast<size_t>(parity_size+2));
+    for (size_t len : lengths){
+        EXPECT_EQ(e_buf.peek().size(), sizeof(VarHeader) + len);
+        e_buf.pop();
+    }
+    // parity of the longest message (2 + 10 bytes -> 3 blocks of 3 bytes)
+    EXPECT_EQ(e_buf.peek().size(), sizeof(VarHeader) + 12);
+    e_buf.pop();
+    EXPECT_EQ(e_buf.peek().size(), sizeof(VarHeader) + 12);
+    e_buf.pop();
+    EXPECT_TRUE(e_buf.peek().empty());
+}
+
+TEST_F(RuntimeTest, drop_restoration_test){
+    const size_t max_payload = 300;
+    for (int parity_size : {2, 4, 6, 10, 12, 16, 30}){
+        std::cout << parity_size << std::endl;
+        const int item_num = parity_size*3;
+        auto pipe = encode(parity_size, max_payload, item_num);
+        ASSERT_EQ(pipe.size(), static_cast<size_t>(3*(parity_size+2)));
+
+        // all pairs of lost packets in the second group
+        for (int a=0; a<parity_size+2; a++){
+            for (int b=a; b<parity_size+2; b++){
+                VarDecodeBuffer d_buf(parity_size, max_payload);
+                for (size_t i=0; i<pipe.size(); i++){
+                    const int pos = i - (parity_size+2);
+                    if (pos != a && pos != b){
+                        EXPECT_EQ(d_buf.enq(pipe[i].data(), pipe[i].size()), Status::OK);
+                    }
+                }
+                ASSERT_EQ(d_buf.count(), static_cast<size_t>(item_num));
+                std::vector<uint8_t> out(max_payload);
+                size_t len;
+                ItemInfo info;
+                for (int i=0; i<item_num; i++){
+                    ASSERT_EQ(d_buf.deq(out.data(), &len, &info), Status::OK);
+                    EXPECT_EQ(info.index, static_cast<uint64_t>(i));
+                    std::string m = message(i, max_payload);
+                    ASSERT_EQ(len, m.size());
+                    EXPECT_EQ(memcmp(out.data(), m.data(), len), 0);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(RuntimeTest, reorder_and_loss_test){
+    const int parity_size = 4;
+    const size_t max_payload = 50;
+    const int item_num = parity_size*4;
+    auto pipe = encode(parity_size, max_payload, item_num);
+
+    // the group 1 overtakes the group 0, and 3 packets of the group 2 are lost
+    std::vector<Packet> recv;
+    recv.push_back(pipe[0]);
+    for (int i=parity_size+2; i<2*(parity_size+2); i++)
+        recv.push_back(pipe[i]);
+    for (int i=1; i<parity_size+2; i++)
+        recv.push_back(pipe[i]);
+    for (size_t i=2*(parity_size+2); i<pipe.size(); i++){
+        if (i != 2*(parity_size+2) && i != 2*(parity_size+2)+1 && i != 2*(parity_size+2)+3)
+            recv.push_back(pipe[i]);
+    }
+
+    VarDecodeBuffer d_buf(parity_size, max_payload);
+    std::vector<uint8_t> out(max_payload);
+    size_t len;
+    ItemInfo info;
+    std::vector<uint64_t> lost;
+    std::vector<uint64_t> got;
+    auto drain = [&]{
+        Status status;
+        while ((status = d_buf.deq(out.data(), &len, &info)) != Status::NO_ELEMENT){
+            if (status == Status::LOST){
+                for (uint64_t i=0; i<info.lost; i++)
+                    lost.push_back(info.index + i);
+            }
+            else{
+                got.push_back(info.index);
+            }
+        }
+    };
+    for (auto& packet : recv){
+        d_buf.enq(packet.data(), packet.size());
+        drain();
+    }
+    // the group 2 is given up by the next epoch
+    VarEncodeBuffer e_buf(parity_size, max_payload);
+    e_buf.reset();
+    e_buf.enq("x", 1);
+    std::vector<uint8_t> buf(e_buf.packet_capacity());
+    e_buf.deq(buf.data(), &len);
+    d_buf.enq(buf.data(), len);
+    drain();
+
+    // the old epoch: items 0..15 except the lost 8, 9, 11, then the item 0 of the new epoch
+    EXPECT_EQ(lost, (std::vector<uint64_t>{8, 9, 11}));
+    std::vector<uint64_t> expected;
+    for (uint64_t i=0; i<static_cast<uint64_t>(item_num); i++){
+        if (i != 8 && i != 9 && i != 11)
+            expected.push_back(i);
+    }
+    expected.push_back(0);
+    EXPECT_EQ(got, expected);
+    EXPECT_EQ(len, 1u);
+}
@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "RPPP_session.hpp"
+#include <vector>
+#include <map>
+#include <random>
+
+using namespace rppp;
+
+class SessionTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int flow;
+        int x;
+    };
+    using Manager = SessionManager<NetVar, 4>;
+};
+
+TEST_F(SessionTest, open_close_test){
+    Manager sessions;
+    std::map<uint64_t, Manager::Session*> expected;
+    std::mt19937 rng(1);
+
+    // random open / close against std::map (the table grows and shifts entries back)
+    for (int i=0; i<20000; i++){
+        const uint64_t flow = rng()%2000;
+        if (rng()%3){
+            Manager::Session* s = sessions.open(flow);
+            ASSERT_NE(s, nullptr);
+            EXPECT_EQ(s->flow, flow);
+            if (expected.count(flow)){
+                EXPECT_EQ(s, expected[flow]);
+            }
+            expected[flow] = s;
+        }
+        else{
+            EXPECT_EQ(sessions.close(flow), expected.erase(flow) ? Status::OK : Status::NO_ELEMENT);
+        }
+        ASSERT_EQ(sessions.size(), expected.size());
+    }
+    for (uint64_t flow=0; flow<2000; flow++)
+        EXPECT_EQ(sessions.find(flow), expected.count(flow) ? expected[flow] : nullptr);
+
+    size_t n = 0;
+    sessions.for_each([&](Manager::Session& s){
+        EXPECT_EQ(expected[s.flow], &s);
+        n++;
+    });
+    EXPECT_EQ(n, expected.size());
+    EXPECT_GE(sessions.memory_per_session(), Manager::session_bytes());
+    EXPECT_EQ(Manager::session_bytes()%64, 0u);
+}
+
+TEST_F(SessionTest, limit_test){
+    Manager sessions(2);
+    EXPECT_NE(sessions.open(10), nullptr);
+    EXPECT_NE(sessions.open(20), nullptr);
+    EXPECT_EQ(sessions.open(30), nullptr);
+    EXPECT_NE(sessions.open(10), nullptr);
+
+    // a closed slot is reused by a new session from scratch
+    sessions.open(10)->encoder.enq(NetVar{10, 1});
+    EXPECT_EQ(sessions.close(10), Status::OK);
+    Manager::Session* s = sessions.open(30);
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->encoder.count(), 0u);
+    EXPECT_EQ(sessions.size(), 2u);
+}
+
+TEST_F(SessionTest, route_test){
+    constexpr int flows = 300;
+    constexpr int items = 4*10;
+    Manager senders;
+    Manager receivers;
+
+    // packets of all flows interleaved, a data packet of every group lost
+    std::vector<Manager::Data> packets;
+    std::vector<uint64_t> packet_flows;
+    for (int i=0; i<items; i++){
+        for (int f=0; f<flows; f++){
+            Manager::Session* s = senders.open(f*7919);
+            s->encoder.enq(NetVar{f, i});
+            Manager::Data sd;
+            while (s->encoder.deq(&sd) == Status::OK){
+                if (sd.header.seq_id%6 == f%4)
+                    continue;
+                packets.push_back(sd);
+                packet_flows.push_back(s->flow);
+            }
+        }
+    }
+    std::vector<Manager::Datagram> datagrams;
+    for (size_t i=0; i<packets.size(); i++)
+        datagrams.push_back({packet_flows[i], &packets[i]});
+
+    receivers.set_auto_open(false);
+    EXPECT_EQ(receivers.enq_batch(datagrams), 0u);
+    EXPECT_EQ(receivers.unrouted(), datagrams.size());
+
+    // batches of a recvmmsg() size, and the items are taken out between them
+    receivers.set_auto_open(true);
+    std::map<uint64_t, int> next;
+    for (size_t i=0; i<datagrams.size(); i+=64){
+        const size_t num = std::min<size_t>(64, datagrams.size()-i);
+        EXPECT_EQ(receivers.enq_batch({datagrams.data()+i, num}), num);
+        receivers.for_each([&](Manager::Session& s){
+            NetVar out;
+            while (s.decoder.deq(&out) == Status::OK){
+                EXPECT_EQ(static_cast<uint64_t>(out.flow)*7919, s.flow);
+                EXPECT_EQ(out.x, next[s.flow]++);
+            }
+        });
+    }
+    EXPECT_EQ(receivers.size(), static_cast<size_t>(flows));
+    EXPECT_EQ(next.size(), static_cast<size_t>(flows));
+    for (auto& n : next)
+        EXPECT_EQ(n.second, items);
+}
@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "RPPP_sliding.hpp"
+#include <vector>
+#include <random>
+
+using namespace rppp;
+
+class SlidingTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        uint8_t pad[27];
+    };
+    static constexpr int interval = 4;
+    static constexpr int window = 8;
+    using Encoder = SlidingEncodeBuffer<NetVar, interval, window>;
+    using Decoder = SlidingDecodeBuffer<NetVar, interval, window>;
+    using Packet = StreamData<NetVar, 1, SlidingHeader>;
+
+    static NetVar item(int i){
+        NetVar v {};
+        v.x = i;
+        for (size_t b=0; b<sizeof(v.pad); b++)
+            v.pad[b] = static_cast<uint8_t>(i*7 + b);
+        return v;
+    }
+
+    static void expect_item(const NetVar& v, int i){
+        EXPECT_EQ(v.x, i);
+        for (size_t b=0; b<sizeof(v.pad); b++)
+            EXPECT_EQ(v.pad[b], static_cast<uint8_t>(i*7 + b));
+    }
+
+    static std::vector<Packet> encode(int items){
+        Encoder encoder;
+        std::vector<Packet> packets;
+        Packet sd;
+        for (int i=0; i<items; i++){
+            EXPECT_NE(encoder.enq(item(i)), Status::BUFFER_FULL);
+            while (encoder.deq(&sd) == Status::OK)
+                packets.push_back(sd);
+        }
+        return packets;
+    }
+};
+
+TEST_F(SlidingTest, no_loss_test){
+    auto packets = encode(100);
+    EXPECT_EQ(packets.size(), 125u);
+    EXPECT_EQ(packets[4].header.count, 4u);     // the first repair covers 4 items
+    EXPECT_EQ(packets[9].header.count, 8u);
+    Decoder decoder;
+    NetVar v;
+    int i = 0;
+    for (auto& sd : packets){
+        EXPECT_EQ(decoder.enq(sd), Status::OK);
+        while (decoder.deq(&v) == Status::OK)
+            expect_item(v, i++);
+    }
+    EXPECT_EQ(i, 100);
+}
+
+TEST_F(SlidingTest, recovery_latency_test){
+    // item 5 is lost: it is recovered by the next repair (after item 7), not at the end of a group
+    auto packets = encode(40);
+    Decoder decoder;
+    NetVar v;
+    ItemInfo info;
+    int next = 0;
+    for (auto& sd : packets){
+        if (sd.header.count == 0 && sd.header.seq == 5)
+            continue;
+        decoder.enq(sd);
+        while (decoder.deq(&v, &info) == Status::OK){
+            expect_item(v, next);
+            EXPECT_EQ(info.recovered, next == 5);
+            next++;
+        }
+        if (sd.header.count == 0 && sd.header.seq == 7){
+            EXPECT_EQ(next, 5);
+        }
+        if (sd.header.count && sd.header.seq == 7){
+            EXPECT_EQ(next, 8);
+        }
+    }
+    EXPECT_EQ(next, 40);
+}
+
+TEST_F(SlidingTest, burst_test){
+    // items 9, 10 and 13 lost: 3 unknowns in the repairs of 4..11, 8..15 and 12..19
+    auto packets = encode(60);
+    Decoder decoder;
+    NetVar v;
+    ItemInfo info;
+    int next = 0;
+    for (auto& sd : packets){
+        if (sd.header.count == 0 && (sd.header.seq == 9 || sd.header.seq == 10 || sd.header.seq == 13))
+            continue;
+        decoder.enq(sd);
+        while (decoder.deq(&v, &info) == Status::OK){
+            expect_item(v, next);
+            EXPECT_EQ(info.recovered, next == 9 || next == 10 || next == 13);
+            next++;
+        }
+    }
+    EXPECT_EQ(next, 60);
+}
+
+TEST_F(SlidingTest, random_loss_test){
+    // the items are output in order, and an item is either delivered or given up once
+    auto packets = encode(4000);
+    std::mt19937 rng(5);
+    std::vector<Packet> sent;
+    sent.push_back(packets[0]); // the decoder starts at the first packet
+    for (size_t i=1; i<packets.size(); i++){
+        if (rng()%100 >= 8)
+            sent.push_back(packets[i]);
+    }
+    for (size_t i=1; i+1<sent.size(); i+=3){
+        if (rng()%4 == 0)
+            std::swap(sent[i], sent[i+1]);
+    }
+
+    Decoder decoder;
+    NetVar v;
+    ItemInfo info;
+    int next = 0, given_up = 0, recovered = 0;
+    auto drain = [&]{
+        for (;;){
+            const Status status = decoder.deq(&v, &info);
+            if (status == Status::NO_ELEMENT)
+                return;
+            ASSERT_EQ(info.index, static_cast<uint64_t>(next));
+            if (status == Status::LOST){
+                next += info.lost;
+                given_up += info.lost;
+            }
+            else{
+                expect_item(v, next++);
+                recovered += info.recovered;
+            }
+        }
+    };
+    for (auto& sd : sent){
+        EXPECT_EQ(decoder.enq(sd), Status::OK);
+        drain();
+    }
+    decoder.finish();
+    drain();
+    EXPECT_EQ(next, 4000);
+    EXPECT_GT(recovered, 200);
+    EXPECT_LT(given_up, 100);
+}
+
+TEST_F(SlidingTest, reset_test){
+    Encoder encoder;
+    Decoder decoder;
+    Packet sd;
+    NetVar v;
+    std::vector<int> out;
+    for (int i=0; i<6; i++){
+        encoder.enq(item(i));
+        while (encoder.deq(&sd) == Status::OK){
+            if (sd.header.seq != 2)
+                decoder.enq(sd);
+        }
+    }
+    // item 2 is recovered by the repair of items 0..3. item 5 is the last one of the old epoch
+    encoder.reset();
+    for (int i=0; i<4; i++){
+        encoder.enq(item(100+i));
+        while (encoder.deq(&sd) == Status::OK)
+            decoder.enq(sd);
+    }
+    while (decoder.deq(&v) == Status::OK)
+        out.push_back(v.x);
+    EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4, 5, 100, 101, 102, 103}));
+}
+
+TEST_F(SlidingTest, invalid_test){
+    Decoder decoder;
+    Packet sd {};
+    sd.header.count = window+1;
+    EXPECT_EQ(decoder.enq(sd), Status::INVALID_ARGUMENT);
+}
@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+#include "RPPP.hpp"
+#include "RPPP_runtime.hpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace rppp;
+
+class StatsTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        int y;
+    };
+    static constexpr int parity_size = 4;
+
+    static std::vector<StreamData<NetVar, parity_size>> encode(int group_num){
+        EncodeBuffer<NetVar, parity_size> e_buf;
+        std::vector<StreamData<NetVar, parity_size>> pipe;
+        StreamData<NetVar, parity_size> sd;
+        for (int i=0; i<group_num*parity_size; i++){
+            e_buf.enq(NetVar{i, -i});
+            while (e_buf.deq(&sd) == Status::OK)
+                pipe.push_back(sd);
+        }
+        return pipe;
+    }
+};
+
+TEST_F(StatsTest, histogram_test){
+    EXPECT_TRUE(RPPP_STATS);
+    for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 100ull, 1000ull, 123456789ull, (1ull << 39) + 12345}){
+        const int b = stats::bucket_of(v);
+        EXPECT_LE(stats::bucket_floor(b), v);
+        EXPECT_LT(v, stats::bucket_floor(b+1));
+        EXPECT_LE(v - stats::bucket_floor(b), v/16);
+    }
+    EXPECT_EQ(stats::bucket_of(1ull << 50), stats::histogram_buckets-1);
+
+    stats::Histogram h;
+    for (uint64_t v=1; v<=1000; v++)
+        h.record(v);
+    auto s = h.snapshot();
+    EXPECT_EQ(s.count(), 1000u);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.5)), 500, 500/16.0);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.99)), 990, 990/16.0);
+    EXPECT_EQ(stats::HistogramSnapshot().percentile(0.5), 0u);
+}
+
+TEST_F(StatsTest, encode_stats_test){
+    EncodeBuffer<NetVar, parity_size> e_buf;
+    // the output keeps a group, so the items after the first group are refused
+    for (int i=0; i<parity_size*3; i++)
+        e_buf.enq(NetVar{i, i});
+    auto s = e_buf.stats();
+    EXPECT_EQ(s.items, static_cast<uint64_t>(parity_size));
+    EXPECT_EQ(s.groups, 1u);
+    EXPECT_EQ(s.packets, parity_size + 2u);
+    EXPECT_EQ(s.buffer_full, 2u*parity_size);
+}
+
+TEST_F(StatsTest, decode_stats_test){
+    auto pipe = encode(8);
+    const int g = parity_size+2;
+    // group 0: clean, 1: a data lost, 2: P lost, 3: 2 data lost, 4: 3 lost, 5: a duplicate and Q lost
+    std::vector<int> lost = {g+1, 2*g+parity_size, 3*g, 3*g+2, 4*g, 4*g+1, 4*g+2, 5*g+parity_size+1};
+    DecodeBuffer<NetVar, parity_size> d_buf;
+    NetVar item;
+    ItemInfo info;
+    uint64_t items = 0, gaps = 0;
+    auto receive = [&]{
+        Status status;
+        while ((status = d_buf.deq(&item, &info)) != Status::NO_ELEMENT)
+            (status == Status::OK ? items : gaps) += (status == Status::OK ? 1 : info.lost);
+    };
+    for (int i=0; i<6*g; i++){
+        if (std::find(lost.begin(), lost.end(), i) != lost.end())
+            continue;
+        d_buf.enq(pipe[i]);
+        if (i == 5*g)
+            d_buf.enq(pipe[i]);
+        receive();
+    }
+
+    auto s = d_buf.stats();
+    // parity after the group is complete: P, Q of 0, Q of 1, Q of 2
+    EXPECT_EQ(s.stale, 4u);
+    EXPECT_EQ(s.packets, 6u*g - lost.size() - s.stale);
+    EXPECT_EQ(s.duplicates, 1u);
+    EXPECT_EQ(s.groups_clean, 3u);
+    EXPECT_EQ(s.groups_p, 1u);
+    EXPECT_EQ(s.groups_pq, 1u);
+    EXPECT_EQ(s.groups_lost, 0u); // the group 4 is still in the window
+    EXPECT_EQ(s.items, 4u*parity_size); // the group 5 waits for the group 4
+    EXPECT_EQ(s.items_recovered, 3u);
+    EXPECT_EQ(s.latency.count(), s.items);
+    EXPECT_EQ(s.decode_time.count(), 2u);
+
+    // a packet 2 groups ahead gives up the group 4, and then its lost packet is stale
+    d_buf.enq(pipe[7*g]);
+    d_buf.enq(pipe[4*g]);
+    receive();
+    s = d_buf.stats();
+    EXPECT_EQ(s.groups_lost, 1u);
+    EXPECT_EQ(s.items_lost, 3u);
+    EXPECT_EQ(s.stale, 5u);
+    EXPECT_EQ(s.items, items);
+    EXPECT_EQ(s.items_lost, gaps);
+    EXPECT_EQ(items, 6u*parity_size - 3); // the group 7 waits for the group 6
+}
+
+TEST_F(StatsTest, var_decode_stats_test){
+    VarEncodeBuffer encoder(parity_size, 100);
+    VarDecodeBuffer decoder(parity_size, 100);
+    const int g = parity_size+2;
+    // group 0: clean, 1: a data lost, 2: 2 data lost, 3: 3 data lost
+    std::vector<int> lost = {g+1, 2*g, 2*g+1, 3*g, 3*g+1, 3*g+2};
+    std::vector<uint8_t> packet(encoder.packet_capacity()), out(100);
+    size_t len;
+    int pos = 0;
+    for (int i=0; i<4*parity_size; i++){
+        encoder.enq(out.data(), i);
+        while (encoder.deq(packet.data(), &len) == Status::OK){
+            if (std::find(lost.begin(), lost.end(), pos++) == lost.end())
+                decoder.enq(packet.data(), len);
+        }
+        while (decoder.deq(out.data(), &len) == Status::OK);
+    }
+    decoder.finish();
+    while (decoder.deq(out.data(), &len) == Status::OK);
+
+    auto s = decoder.stats();
+    // parity after the group is complete: P, Q of 0, Q of 1
+    EXPECT_EQ(s.stale, 3u);
+    EXPECT_EQ(s.packets, 4u*g - lost.size() - s.stale);
+    EXPECT_EQ(s.groups_clean, 1u);
+    EXPECT_EQ(s.groups_p, 1u);
+    EXPECT_EQ(s.groups_pq, 1u);
+    EXPECT_EQ(s.groups_lost, 1u);
+    EXPECT_EQ(s.items, 3u*parity_size + 1);
+    EXPECT_EQ(s.items_recovered, 3u);
+    EXPECT_EQ(s.items_lost, 3u);
+}
+
+TEST_F(StatsTest, concurrent_read_test){
+    auto pipe = encode(1000);
+    DecodeBuffer<NetVar, parity_size> d_buf;
+    std::atomic<bool> done {false};
+    std::thread reader([&]{
+        uint64_t last = 0;
+        while (not done){
+            auto s = d_buf.stats();
+            EXPECT_GE(s.items, last);
+            last = s.items;
+        }
+    });
+    NetVar item;
+    for (auto& sd : pipe){
+        d_buf.enq(sd);
+        while (d_buf.deq(&item) == Status::OK);
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(d_buf.stats().items, 1000u*parity_size);
+}
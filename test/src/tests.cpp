@@ -4,6 +4,8 @@
 #include <array>
 #include <bitset>
 #include <cstring>
+#include <memory>
+#include <utility>
 
 using namespace rppp;
 
@@ -72,7 +74,9 @@ protected:
     struct encode_logic_test{
     void operator()(){
         std::cout << typeid(T).name() << " " << parity_size << std::endl;
-        auto bytes = ((sizeof(T)+(parity_size-1))/parity_size)*parity_size;
+        // the geometry has padded columns: parity_size data, virtual zero columns, P
+        const int padded = padded_size(parity_size);
+        auto bytes = ((sizeof(T)+(padded-1))/padded)*padded;
         EncodeBuffer<T, parity_size> e_buf;
 
         // prepare data
@@ -113,27 +117,64 @@ protected:
         }
 
         // diagonal parity test
-        auto block_bytes = bytes/parity_size;
-        EXPECT_EQ(sizeof(pipe[0].data), block_bytes*parity_size);
+        auto block_bytes = bytes/padded;
+        EXPECT_EQ(sizeof(pipe[0].data), block_bytes*padded);
 
-        for (int i=0; i<parity_size; i++){
+        for (int i=0; i<padded; i++){
             for(size_t j=0; j<block_bytes; j++){
                 uint8_t q = pipe[parity_size+1].data[i*block_bytes+j];
                 uint8_t cmp = 0;
-                for (int k=0; k<parity_size; k++)
-                    cmp ^= pipe[(i+k)%(parity_size+1)].data[k*block_bytes+j];
+                for (int k=0; k<padded; k++){
+                    const int c = (i+k)%(padded+1);
+                    if (c < parity_size)
+                        cmp ^= pipe[c].data[k*block_bytes+j];
+                    else if (c == padded)
+                        cmp ^= pipe[parity_size].data[k*block_bytes+j];
+                }
                 EXPECT_EQ(q, cmp);
             }
         }
     }
     };
 
+    template<typename T, int parity_size>
+    struct encode_multi_group_test{
+    void operator()(){
+        std::cout << typeid(T).name() << " " << parity_size << std::endl;
+        EncodeBuffer<T, parity_size> e_buf;
+
+        // prepare data
+        std::array<T,parity_size> in;
+        for (size_t i=0; i<in.size(); i++){
+            memcpy(&in[i], randomdata.random + i, sizeof(T));
+        }
+
+        // the parity of every group must be the same as the first group
+        std::array<StreamData<T, parity_size>, parity_size+2> first;
+        for (int group=0; group<3; group++){
+            for (int i=0; i<parity_size; i++)
+                e_buf.enq(in[i]);
+            EXPECT_EQ(e_buf.count(), parity_size+2);
+
+            for (int i=0; i<parity_size+2; i++){
+                StreamData<T, parity_size> pipe;
+                EXPECT_EQ(e_buf.deq(&pipe), Status::OK);
+                EXPECT_EQ(pipe.header.seq_id, group*(parity_size+2) + i);
+                if (group == 0)
+                    first[i] = pipe;
+                else
+                    EXPECT_EQ(memcmp(first[i].data, pipe.data, sizeof(pipe.data)), 0);
+            }
+        }
+    }
+    };
+
     template<typename T, int parity_size>
     struct decode_simple_test{
     void operator()(){
         std::cout << typeid(T).name() << " " << parity_size << std::endl;
         DecodeBuffer<T, parity_size> d_buf;
-        StreamData<T, parity_size> in;
+        StreamData<T, parity_size> in {};
         in.header.seq_id = 0;
         for(size_t i=0; i<sizeof(in.data); i++){
             in.data[i] = i;
@@ -156,7 +197,7 @@ protected:
         DecodeBuffer<T, parity_size> d_buf;
 
         // prepare data
-        std::array<StreamData<T, parity_size>, parity_size+2> in;
+        std::array<StreamData<T, parity_size>, parity_size+2> in {};
         for (size_t i=0; i<in.size(); i++){
             in[i].header.seq_id = i;
             memcpy(in[i].data, randomdata.random + i, sizeof(T));
@@ -274,6 +315,113 @@ protected:
     }
     };
 
+    template<typename T, int parity_size>
+    struct batch_test{
+    void operator()(){
+        std::cout << typeid(T).name() << " " << parity_size << std::endl;
+        EncodeBuffer<T, parity_size> e_buf, e_buf_batch;
+        DecodeBuffer<T, parity_size> d_buf;
+        const int item_num = parity_size*5 + 1;
+
+        // prepare data
+        std::vector<T> in(item_num);
+        for (size_t i=0; i<in.size(); i++){
+            memcpy(&in[i], randomdata.random + i%50, sizeof(T));
+        }
+
+        // per item
+        std::vector<StreamData<T, parity_size>> pipe;
+        for (auto& item : in){
+            EXPECT_NE(e_buf.enq(item), Status::BUFFER_FULL);
+            StreamData<T, parity_size> sd;
+            while (e_buf.deq(&sd) == Status::OK)
+                pipe.push_back(sd);
+        }
+
+        // batch
+        std::vector<StreamData<T, parity_size>> pipe_batch(pipe.size() + 10);
+        size_t enqueued = 0, drained = 0;
+        while (enqueued < in.size()){
+            size_t n = e_buf_batch.enq_batch(span<const T>(in).subspan(enqueued));
+            EXPECT_GT(n, 0u);
+            enqueued += n;
+            drained += e_buf_batch.drain(span<StreamData<T, parity_size>>(pipe_batch).subspan(drained));
+        }
+        EXPECT_EQ(drained, pipe.size());
+        EXPECT_EQ(e_buf_batch.count(), 0);
+        for (size_t i=0; i<pipe.size(); i++){
+            EXPECT_EQ(pipe_batch[i].header.seq_id, pipe[i].header.seq_id);
+            EXPECT_EQ(memcmp(pipe_batch[i].data, pipe[i].data, sizeof(pipe[i].data)), 0);
+        }
+
+        // drop one packet of each group (not of the last item, which has no parity) and decode in batch
+        std::vector<StreamData<T, parity_size>> received;
+        for (size_t i=0; i<pipe.size(); i++){
+            const size_t group = i/(parity_size+2);
+            if (group == item_num/parity_size || i%(parity_size+2) != group%(parity_size+2))
+                received.push_back(pipe[i]);
+        }
+        std::vector<T> out(in.size());
+        size_t decoded = 0, packets = 0;
+        while (packets < received.size()){
+            packets += d_buf.enq_batch(span<const StreamData<T, parity_size>>(received).subspan(packets));
+            decoded += d_buf.drain(span<T>(out).subspan(decoded));
+        }
+        EXPECT_EQ(decoded, in.size());
+        for (size_t i=0; i<decoded; i++)
+            EXPECT_EQ(in[i], out[i]);
+    }
+    };
+
+    template<typename T, int parity_size>
+    struct reorder_test{
+    void operator()(){
+        std::cout << typeid(T).name() << " " << parity_size << std::endl;
+        EncodeBuffer<T, parity_size> e_buf;
+        DecodeBuffer<T, parity_size, 2> d_buf;
+        const int group_size = parity_size+2;
+        const int item_num = parity_size*12;
+
+        // prepare data
+        std::vector<T> in(item_num);
+        for (size_t i=0; i<in.size(); i++){
+            memcpy(&in[i], randomdata.random + i%50, sizeof(T));
+        }
+        std::vector<StreamData<T, parity_size>> pipe;
+        for (auto& item : in){
+            e_buf.enq(item);
+            StreamData<T, parity_size> sd;
+            while (e_buf.deq(&sd) == Status::OK)
+                pipe.push_back(sd);
+        }
+
+        // drop 2 packets of each group
+        std::vector<StreamData<T, parity_size>> received;
+        for (size_t i=0; i<pipe.size(); i++){
+            int group = i/group_size;
+            int pos = i%group_size;
+            if (pos != group%group_size && pos != (group*3+1)%group_size)
+                received.push_back(pipe[i]);
+        }
+        // swap neighboors (includes the last of a group and the first of the next group)
+        for (size_t i=0; i+1<received.size(); i+=3)
+            std::swap(received[i], received[i+1]);
+        // duplicate
+        received.insert(received.begin() + received.size()/2, received[received.size()/3]);
+
+        std::vector<T> out;
+        for (auto& sd : received){
+            EXPECT_EQ(d_buf.enq(sd), Status::OK);
+            T item;
+            while (d_buf.deq(&item) == Status::OK)
+                out.push_back(item);
+        }
+        EXPECT_EQ(out.size(), in.size());
+        for (size_t i=0; i<out.size() && i<in.size(); i++)
+            EXPECT_EQ(in[i], out[i]);
+    }
+    };
+
     template<typename T, int parity_size>
     struct encode_boundary_seq_id_test{
     void operator()(){
@@ -281,19 +429,21 @@ protected:
         EncodeBuffer<T, parity_size> e_buf;
         T in {};
         StreamData<T, parity_size> pipe {};
+        bool first = true;
+        bool wrapped = false;
+        seq_id_t prev_seq_id = 0;
         for (int i=0; i<std::numeric_limits<seq_id_t>::max()+2; i++){
-            e_buf.enq(in);
-        }
-        e_buf.deq(&pipe);
-        auto prev_seq_id = pipe.header.seq_id;
-        for (int i=0; i<std::numeric_limits<seq_id_t>::max()+2; i++){
-            e_buf.deq(&pipe);
-            if(pipe.header.seq_id == 0){
-                EXPECT_EQ(prev_seq_id%(parity_size+2), parity_size+1);
-                break;
+            EXPECT_EQ(e_buf.enq(in) == Status::BUFFER_FULL, false);
+            while (e_buf.deq(&pipe) == Status::OK){
+                if(pipe.header.seq_id == 0 && not first){
+                    EXPECT_EQ(prev_seq_id%(parity_size+2), parity_size+1);
+                    wrapped = true;
+                }
+                prev_seq_id = pipe.header.seq_id;
+                first = false;
             }
-            prev_seq_id = pipe.header.seq_id;
         }
+        EXPECT_TRUE(wrapped);
     }
     };
 
@@ -304,6 +454,11 @@ protected:
         DecodeBuffer<T, parity_size> d_buf;
         StreamData<T, parity_size> pipe {};
 
+        T out;
+        auto drain = [&](){
+            while (d_buf.deq(&out) == Status::OK);
+        };
+
         // enqueue some data
         EXPECT_EQ(d_buf.count(), 0);
         for (int i=0; i<10; i++){
@@ -311,7 +466,8 @@ protected:
                 pipe.header.seq_id = i*(parity_size+2) + j;
                 d_buf.enq(pipe);
             }
-            EXPECT_EQ(d_buf.count(), parity_size*(i+1));
+            EXPECT_EQ(d_buf.count(), parity_size);
+            drain();
         }
 
         // push normal data
@@ -319,26 +475,34 @@ protected:
             pipe.header.seq_id = (parity_size+2)*10 + j;
             d_buf.enq(pipe);
         }
-        EXPECT_EQ(d_buf.count(), parity_size*11);
+        EXPECT_EQ(d_buf.count(), parity_size);
         // push parity data
         for (int j=parity_size; j<parity_size+2; j++){
             pipe.header.seq_id = (parity_size+2)*10 + j;
             d_buf.enq(pipe);
         }
-        EXPECT_EQ(d_buf.count(), parity_size*11);
+        EXPECT_EQ(d_buf.count(), parity_size);
+        drain();
 
         // push normal data
         for (int j=0; j<parity_size; j++){
             pipe.header.seq_id = (parity_size+2)*11 + j;
             d_buf.enq(pipe);
         }
-        EXPECT_EQ(d_buf.count(), parity_size*12);
-        // push lower seq_id data
+        EXPECT_EQ(d_buf.count(), parity_size);
+        // push lower seq_id data (expired)
+        for (int j=0; j<2; j++){
+            pipe.header.seq_id = j;
+            d_buf.enq(pipe);
+        }
+        EXPECT_EQ(d_buf.count(), parity_size);
+        // push lower seq_id data of the next epoch (encoder's reset)
+        pipe.header.epoch = 1;
         for (int j=0; j<2; j++){
             pipe.header.seq_id = j;
             d_buf.enq(pipe);
         }
-        EXPECT_EQ(d_buf.count(), parity_size*12 + 2);
+        EXPECT_EQ(d_buf.count(), parity_size + 2);
 
         d_buf.reset();
         for(int i=0; i<1; i++){
@@ -352,19 +516,29 @@ protected:
     template<template<typename T, int parity_size> typename test_func>
     void tester(){
         test_func<NetVar0, 2>()();
+        test_func<NetVar0, 3>()();
         test_func<NetVar0, 4>()();
         test_func<NetVar0, 6>()();
+        test_func<NetVar0, 8>()();
         test_func<NetVar0, 10>()();
         test_func<NetVar0, 12>()();
         test_func<NetVar0, 16>()();
 
         test_func<NetVar1, 2>()();
+        test_func<NetVar1, 3>()();
         test_func<NetVar1, 4>()();
         test_func<NetVar1, 6>()();
+        test_func<NetVar1, 8>()();
         test_func<NetVar1, 10>()();
         test_func<NetVar1, 12>()();
         test_func<NetVar1, 16>()();
     }
+
+    // every parity_size in [2, 2+sizeof...(I))
+    template<template<typename T, int parity_size> typename test_func, class T, int... I>
+    void tester_sizes(std::integer_sequence<int, I...>){
+        (test_func<T, I+2>()(), ...);
+    }
 };
 
 TEST_F(RPPPTest, encode_simple_test){
@@ -375,6 +549,10 @@ TEST_F(RPPPTest, encode_logic_test){
     tester<encode_logic_test>();
 }
 
+TEST_F(RPPPTest, encode_multi_group_test){
+    tester<encode_multi_group_test>();
+}
+
 TEST_F(RPPPTest, decode_simple_test){
     tester<decode_simple_test>();
 }
@@ -387,6 +565,14 @@ TEST_F(RPPPTest, drop_restoration_test) {
     tester<drop_test>();
 }
 
+TEST_F(RPPPTest, batch_test) {
+    tester<batch_test>();
+}
+
+TEST_F(RPPPTest, reorder_test) {
+    tester<reorder_test>();
+}
+
 TEST_F(RPPPTest, encode_boundary_seq_id_test) {
     tester<encode_boundary_seq_id_test>();
 }
@@ -426,4 +612,363 @@ TEST_F(RPPPTest, buf_reset_test){
     pipe.header.seq_id = 0;
     EXPECT_EQ(d_buf.enq(pipe), Status::OK);
     EXPECT_EQ(d_buf.count(), 1);
-}
\ No newline at end of file
+}
+
+TEST_F(RPPPTest, xor_kernel_test){
+    using namespace rppp::simd;
+    std::vector<uint8_t> a(1500), b(1500), c(1500);
+    for (size_t i=0; i<a.size(); i++){
+        a[i] = i*7 + 1;
+        b[i] = i*13 + 5;
+        c[i] = i*31 + 11;
+    }
+
+    for (XorIsa isa : {XorIsa::PORTABLE, XorIsa::SSE2, XorIsa::AVX2, XorIsa::AVX512}){
+        if (not xor_isa_supported(isa))
+            continue;
+        XorKernel kernel = xor_kernel_for(isa);
+        std::cout << kernel.name << std::endl;
+        EXPECT_EQ(kernel.isa, isa);
+
+        for (size_t len : {0, 1, 3, 15, 16, 31, 33, 64, 65, 127, 200, 1400}){
+            for (size_t offset : {0, 1, 7}){
+                // dst ^= src
+                std::vector<uint8_t> dst(a.begin(), a.end());
+                kernel.xor_into(dst.data()+offset, b.data()+offset, len);
+                for (size_t i=0; i<dst.size(); i++){
+                    bool in_range = (i >= offset) && (i < offset+len);
+                    EXPECT_EQ(dst[i], in_range ? uint8_t(a[i]^b[i]) : a[i]);
+                }
+
+                // dst ^= src0 ^ src1
+                dst.assign(a.begin(), a.end());
+                const uint8_t *srcs[] = {b.data()+offset, c.data()+offset};
+                kernel.xor_acc(dst.data()+offset, srcs, 2, len);
+                for (size_t i=0; i<dst.size(); i++){
+                    bool in_range = (i >= offset) && (i < offset+len);
+                    EXPECT_EQ(dst[i], in_range ? uint8_t(a[i]^b[i]^c[i]) : a[i]);
+                }
+            }
+        }
+    }
+}
+
+
+TEST_F(RPPPTest, buf_full_test){
+    EncodeBuffer<NetVar0, 4> e_buf;
+    DecodeBuffer<NetVar0, 4> d_buf;
+    NetVar0 in {};
+
+    // the encoder holds one group (4 data + 2 parity)
+    for (int i=0; i<4; i++)
+        EXPECT_NE(e_buf.enq(in), Status::BUFFER_FULL);
+    EXPECT_EQ(e_buf.count(), 6);
+    EXPECT_EQ(e_buf.enq(in), Status::BUFFER_FULL);
+    EXPECT_EQ(e_buf.count(), 6);
+
+    // peek & pop
+    for (int i=0; i<6; i++){
+        const StreamData<NetVar0, 4> *psd = e_buf.peek();
+        ASSERT_NE(psd, nullptr);
+        EXPECT_EQ(psd->header.seq_id, i);
+        EXPECT_EQ(e_buf.pop(), Status::OK);
+    }
+    EXPECT_EQ(e_buf.peek(), nullptr);
+    EXPECT_EQ(e_buf.pop(), Status::NO_ELEMENT);
+    EXPECT_EQ(e_buf.enq(in), Status::OK);
+
+    // the decoder holds the reorder window + a group of data
+    StreamData<NetVar0, 4> pipe {};
+    for (int i=0; i<3*6; i++){
+        pipe.header.seq_id = i;
+        EXPECT_EQ(d_buf.enq(pipe), Status::OK);
+    }
+    EXPECT_EQ(d_buf.count(), 12);
+    pipe.header.seq_id = 3*6;
+    EXPECT_EQ(d_buf.enq(pipe), Status::BUFFER_FULL);
+    EXPECT_EQ(d_buf.count(), 12);
+}
+
+TEST_F(RPPPTest, drop_restoration_large_test) {
+    drop_test<NetVar1, 30>()();
+    drop_test<NetVar0, 100>()();
+}
+
+TEST_F(RPPPTest, drop_restoration_all_sizes_test) {
+    // parity_size+1 need not be prime (virtual zero columns)
+    static_assert(padded_size(8) == 10 && padded_size(10) == 10 && padded_size(32) == 36, "padded_size");
+    tester_sizes<drop_test, NetVar1>(std::make_integer_sequence<int, 31>{});
+    drop_test<NetVar0, 50>()();
+    drop_test<NetVar0, 99>()();
+}
+
+TEST_F(RPPPTest, reorder_window_test){
+    EncodeBuffer<NetVar0, 4> e_buf;
+    DecodeBuffer<NetVar0, 4, 2> d_buf;
+    NetVar0 out;
+
+    // through the seq_id wrap around, the last packet of a group is swapped with the next group
+    int in_num = 0, out_num = 0;
+    StreamData<NetVar0, 4> sd, held;
+    bool holding = false;
+    for (int i=0; i<std::numeric_limits<seq_id_t>::max()+100; i++){
+        NetVar0 in {in_num++, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK){
+            if (sd.header.seq_id%6 == 5){
+                held = sd;
+                holding = true;
+                continue;
+            }
+            d_buf.enq(sd);
+            if (holding){
+                d_buf.enq(held);
+                holding = false;
+            }
+        }
+        while (d_buf.deq(&out) == Status::OK)
+            EXPECT_EQ(out.x, out_num++);
+    }
+    EXPECT_EQ(out_num, in_num);
+
+    // 3 lost: the received data is output when the group is given up
+    d_buf.reset();
+    e_buf.reset();
+    std::vector<StreamData<NetVar0, 4>> pipe;
+    for (int i=0; i<4*3; i++){
+        NetVar0 in {i, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK)
+            pipe.push_back(sd);
+    }
+    for (int i : {1, 3, 5, 6+1, 6+2, 6+3, 6+4, 6+5})
+        d_buf.enq(pipe[i]);
+    EXPECT_EQ(d_buf.count(), 0); // waiting for the group 0
+    d_buf.enq(pipe[12]); // the group 0 is out of the window
+    std::vector<int> xs;
+    while (d_buf.deq(&out) == Status::OK)
+        xs.push_back(out.x);
+    EXPECT_EQ(xs, (std::vector<int>{1, 3, 4, 5, 6, 7, 8}));
+
+    // a delayed packet of the old epoch is discarded
+    StreamData<NetVar0, 4> old = pipe[13];
+    e_buf.reset();
+    NetVar0 in {100, 0, 0, 0};
+    e_buf.enq(in);
+    e_buf.deq(&sd);
+    EXPECT_EQ(d_buf.enq(sd), Status::OK);
+    EXPECT_EQ(d_buf.enq(old), Status::OK);
+    EXPECT_EQ(d_buf.count(), 1);
+    EXPECT_EQ(d_buf.deq(&out), Status::OK);
+    EXPECT_EQ(out.x, 100);
+}
+
+TEST_F(RPPPTest, early_delivery_test){
+    EncodeBuffer<NetVar0, 4> e_buf;
+    DecodeBuffer<NetVar0, 4, 2> d_buf;
+    d_buf.set_delivery(Delivery::EARLY);
+
+    std::vector<StreamData<NetVar0, 4>> pipe;
+    StreamData<NetVar0, 4> sd;
+    for (int i=0; i<8; i++){
+        NetVar0 in {i, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK)
+            pipe.push_back(sd);
+    }
+
+    NetVar0 out;
+    ItemInfo info;
+    auto expect_item = [&](int x, bool recovered){
+        EXPECT_EQ(d_buf.deq(&out, &info), Status::OK);
+        EXPECT_EQ(out.x, x);
+        EXPECT_EQ(info.index, static_cast<uint64_t>(x));
+        EXPECT_EQ(info.lost, 0u);
+        EXPECT_EQ(info.recovered, recovered);
+    };
+
+    // data 1 is lost, and data of the next group arrives before the parity
+    d_buf.enq(pipe[0]);
+    expect_item(0, false);
+    d_buf.enq(pipe[2]);
+    expect_item(2, false);
+    d_buf.enq(pipe[6+1]);
+    expect_item(5, false);
+    d_buf.enq(pipe[3]);
+    expect_item(3, false);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::NO_ELEMENT);
+    d_buf.enq(pipe[4]); // P
+    expect_item(1, true);
+    for (int i : {5, 6+2, 6+3})
+        d_buf.enq(pipe[i]);
+    expect_item(6, false);
+    expect_item(7, false);
+    d_buf.enq(pipe[6+0]);
+    expect_item(4, false);
+    EXPECT_EQ(d_buf.count(), 0);
+}
+
+TEST_F(RPPPTest, deadline_test){
+    using Clock = DecodeBuffer<NetVar0, 4, 2>::Clock;
+    EncodeBuffer<NetVar0, 4> e_buf;
+    DecodeBuffer<NetVar0, 4, 2> d_buf;
+    d_buf.set_deadline(std::chrono::milliseconds(10));
+
+    std::vector<StreamData<NetVar0, 4>> pipe;
+    StreamData<NetVar0, 4> sd;
+    for (int i=0; i<4*20; i++){
+        NetVar0 in {i, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK)
+            pipe.push_back(sd);
+    }
+
+    NetVar0 out;
+    ItemInfo info;
+    const Clock::time_point t0 = Clock::time_point() + std::chrono::seconds(1);
+
+    // 3 lost in the group 0
+    d_buf.enq(pipe[0], t0);
+    d_buf.enq(pipe[2], t0 + std::chrono::milliseconds(1));
+    d_buf.enq(pipe[5], t0 + std::chrono::milliseconds(2));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::OK);
+    EXPECT_EQ(out.x, 0);
+    d_buf.poll(t0 + std::chrono::milliseconds(9));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::NO_ELEMENT);
+
+    // the deadline has passed
+    d_buf.poll(t0 + std::chrono::milliseconds(10));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 1u);
+    EXPECT_EQ(info.lost, 1u);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::OK);
+    EXPECT_EQ(out.x, 2);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 3u);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::NO_ELEMENT);
+
+    // a late packet of the group 0 is expired
+    d_buf.enq(pipe[1], t0 + std::chrono::milliseconds(11));
+    EXPECT_EQ(d_buf.count(), 0);
+
+    // the group 1 is lost completely and the group 2 has passed the deadline
+    d_buf.enq(pipe[12], t0 + std::chrono::milliseconds(20));
+    d_buf.enq(pipe[14], t0 + std::chrono::milliseconds(20));
+    d_buf.poll(t0 + std::chrono::milliseconds(30));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 4u);
+    EXPECT_EQ(info.lost, 4u);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::OK);
+    EXPECT_EQ(out.x, 8);
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 9u);
+    EXPECT_EQ(d_buf.count(), 1u); // given up items are not counted
+    EXPECT_EQ(d_buf.deq(&out), Status::OK);
+    EXPECT_EQ(out.x, 10);
+    EXPECT_EQ(d_buf.deq(&out), Status::NO_ELEMENT); // the given up item 11 is skipped
+
+    // a long outage is reported as one gap
+    d_buf.enq(pipe[6*3], t0 + std::chrono::milliseconds(40));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::OK);
+    EXPECT_EQ(out.x, 12);
+    d_buf.enq(pipe[6*19], t0 + std::chrono::milliseconds(41));
+    EXPECT_EQ(d_buf.deq(&out, &info), Status::LOST);
+    EXPECT_EQ(info.index, 13u);
+    EXPECT_EQ(info.lost, 4u*18 - 13);
+    EXPECT_EQ(d_buf.count(), 0);
+}
+
+TEST_F(RPPPTest, group_header_test){
+    using SD = StreamData<NetVar0, 4, GroupHeader>;
+    EncodeBuffer<NetVar0, 4, GroupHeader> e_buf;
+    DecodeBuffer<NetVar0, 4, 2, GroupHeader> d_buf;
+    NetVar0 out;
+    SD sd;
+
+    // far beyond the 16bit seq_id, a data packet is lost in every group
+    int in_num = 0, out_num = 0;
+    for (int i=0; i<4*40000; i++){
+        NetVar0 in {in_num++, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK){
+            if (sd.header.pos == sd.header.group_id%4)
+                continue;
+            EXPECT_EQ(d_buf.enq(sd), Status::OK);
+        }
+        while (d_buf.deq(&out) == Status::OK)
+            EXPECT_EQ(out.x, out_num++);
+    }
+    EXPECT_EQ(out_num, in_num);
+    EXPECT_EQ(sd.header.group_id, 40000u - 1);
+
+    // the group number wraps around
+    d_buf.reset();
+    e_buf.reset();
+    std::vector<SD> pipe;
+    for (int i=0; i<4*2; i++){
+        NetVar0 in {i, 0, 0, 0};
+        e_buf.enq(in);
+        while (e_buf.deq(&sd) == Status::OK)
+            pipe.push_back(sd);
+    }
+    for (size_t i=0; i<pipe.size(); i++)
+        pipe[i].header.group_id = std::numeric_limits<uint32_t>::max() + static_cast<uint32_t>(i/6);
+    out_num = 0;
+    for (size_t i=0; i<pipe.size(); i++){
+        if (i == 2 || i == 6+3)
+            continue;
+        EXPECT_EQ(d_buf.enq(pipe[i]), Status::OK);
+    }
+    while (d_buf.deq(&out) == Status::OK)
+        EXPECT_EQ(out.x, out_num++);
+    EXPECT_EQ(out_num, 8);
+
+    // a delayed packet of a given up group and duplicates don't restart the decoder
+    EXPECT_EQ(d_buf.enq(pipe[0]), Status::OK);
+    EXPECT_EQ(d_buf.enq(pipe[7]), Status::OK);
+    EXPECT_EQ(d_buf.count(), 0);
+
+    // a position out of the group is rejected
+    sd = pipe[0];
+    sd.header.pos = 6;
+    EXPECT_EQ(d_buf.enq(sd), Status::INVALID_ARGUMENT);
+}
+
+TEST_F(RPPPTest, group_matrix_test){
+    // columns start on cache lines, and a short last column is padded
+    using Matrix = GroupMatrix<6, 100>;
+    EXPECT_EQ(Matrix::stride, 128u);
+    EXPECT_EQ(alignof(Matrix), 64u);
+    auto m = std::make_unique<Matrix>();
+    for (int c=0; c<6; c++){
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(m->column(c))%64, 0u);
+        EXPECT_EQ(m->column(c) - m->column(0), static_cast<ptrdiff_t>(c*Matrix::stride));
+    }
+
+    // a heap decoder recovers every pair of lost columns from the padded columns
+    struct Item{
+        uint8_t data[99];
+    };
+    for (int a=0; a<6; a++){
+        for (int b=a+1; b<6; b++){
+            EncodeBuffer<Item, 4> e_buf;
+            auto d_buf = std::make_unique<DecodeBuffer<Item, 4>>();
+            StreamData<Item, 4> sd;
+            Item in, out;
+            for (int i=0; i<4; i++){
+                for (size_t k=0; k<sizeof(in.data); k++)
+                    in.data[k] = static_cast<uint8_t>(i*101 + k);
+                e_buf.enq(in);
+            }
+            for (int pos=0; e_buf.deq(&sd) == Status::OK; pos++){
+                if (pos != a && pos != b)
+                    d_buf->enq(sd);
+            }
+            for (int i=0; i<4; i++){
+                ASSERT_EQ(d_buf->deq(&out), Status::OK);
+                for (size_t k=0; k<sizeof(out.data); k++)
+                    EXPECT_EQ(out.data[k], static_cast<uint8_t>(i*101 + k));
+            }
+        }
+    }
+}
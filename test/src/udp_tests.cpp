@@ -0,0 +1,134 @@
+#if defined(__linux__)
+#include "gtest/gtest.h"
+#include "RPPP_udp.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <chrono>
+
+using namespace rppp;
+
+class UdpTest : public ::testing::Test {
+
+protected:
+    struct NetVar{
+        int x;
+        int y;
+        uint8_t z;
+    };
+
+    int m_rx = -1;
+    int m_tx = -1;
+
+    void SetUp() override{
+        // a non blocking receiver on a loopback port, and a sender connected to it
+        m_rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        m_tx = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(m_rx, 0);
+        ASSERT_GE(m_tx, 0);
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(bind(m_rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        socklen_t len = sizeof(addr);
+        ASSERT_EQ(getsockname(m_rx, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+        ASSERT_EQ(connect(m_tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    }
+
+    void TearDown() override{
+        close(m_rx);
+        close(m_tx);
+    }
+
+    template<int parity_size>
+    void loopback(bool gso){
+        UdpSender<NetVar, parity_size> sender(m_tx, nullptr, 0, gso);
+        UdpReceiver<NetVar, parity_size> receiver(m_rx);
+        int next = 0;
+        auto on_item = [&](const NetVar& out){
+            EXPECT_EQ(out.x, next);
+            EXPECT_EQ(out.y, -next);
+            next++;
+        };
+
+        const int num = parity_size*200;
+        for (int i=0; i<num; i++){
+            ASSERT_NE(sender.send(NetVar{i, -i, static_cast<uint8_t>(i)}), Status::IO_ERROR);
+            ASSERT_GE(receiver.receive(on_item), 0);
+        }
+        EXPECT_EQ(next, num);
+        EXPECT_EQ(sender.sent(), static_cast<size_t>(num/parity_size*(parity_size+2)));
+        EXPECT_EQ(receiver.received(), sender.sent());
+        EXPECT_EQ(receiver.invalid(), 0u);
+
+        // the packets of an unfinished group wait for flush()
+        sender.send(NetVar{num, -num, 0});
+        EXPECT_EQ(receiver.receive(on_item), 0);
+        EXPECT_EQ(sender.flush(), 1);
+        EXPECT_EQ(receiver.receive(on_item), 1);
+        EXPECT_EQ(next, num+1);
+    }
+};
+
+TEST_F(UdpTest, sendmmsg_test){
+    loopback<4>(false);
+    loopback<30>(false);
+}
+
+TEST_F(UdpTest, gso_test){
+    loopback<4>(true);
+    loopback<100>(true); // more than 64 segments in a group
+}
+
+TEST_F(UdpTest, invalid_size_test){
+    UdpReceiver<NetVar, 4> receiver(m_rx);
+    const char junk[3] = {1, 2, 3};
+    ASSERT_EQ(send(m_tx, junk, sizeof(junk), 0), static_cast<ssize_t>(sizeof(junk)));
+    int items = 0;
+    EXPECT_EQ(receiver.receive([&](const NetVar&){ items++; }), 1);
+    EXPECT_EQ(receiver.invalid(), 1u);
+    EXPECT_EQ(receiver.received(), 0u);
+    EXPECT_EQ(items, 0);
+}
+
+TEST_F(UdpTest, blocking_receive_test){
+    // a blocking socket: receive(..., 0) returns after the datagrams of a group, not `batch` of them
+    const int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(rx, 0);
+    const timeval timeout {5, 0};  // fail instead of hanging
+    ASSERT_EQ(setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)), 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+
+    UdpSender<NetVar, 4> sender(m_tx, reinterpret_cast<sockaddr*>(&addr), len, false);
+    UdpReceiver<NetVar, 4> receiver(rx);
+    for (int i=0; i<4; i++)
+        ASSERT_NE(sender.send(NetVar{i, -i, 0}), Status::IO_ERROR);
+    int items = 0;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(receiver.receive([&](const NetVar&){ items++; }, 0), 6);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_EQ(items, 4);
+    close(rx);
+}
+
+TEST_F(UdpTest, send_error_test){
+    // no destination: the group is dropped and send() reports it
+    const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(tx, 0);
+    for (bool gso : {true, false}){
+        UdpSender<NetVar, 4> sender(tx, nullptr, 0, gso);
+        for (int i=0; i<3; i++)
+            EXPECT_EQ(sender.send(NetVar{i, -i, 0}), Status::OK);
+        EXPECT_EQ(sender.send(NetVar{3, -3, 0}), Status::IO_ERROR);
+        EXPECT_EQ(sender.sent(), 0u);
+        EXPECT_EQ(sender.encoder().count(), 0u);
+    }
+    close(tx);
+}
+#endif